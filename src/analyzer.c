@@ -0,0 +1,388 @@
+/*
+ * analyzer.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Plays out every card that could come next from the composition of the
+ *  shoe (how many of each rank are left). Hands are (score,soft) the same
+ *  as player_hit() keeps them and the dealer stands on DEALER_STANDS. When
+ *  the shoe runs out it starts over with a full one like shoe_draw().
+ *  Payouts are the same as player_settle().
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "blackjack.h"
+#include "analyzer.h"
+
+// Slots the memo starts with, it doubles when half full
+#ifndef ANALYZER_MEMO_SIZE
+#define ANALYZER_MEMO_SIZE 4096
+#endif
+
+#define ANALYZER_USED (1U<<31)
+#define ANALYZER_PLAYER (1U<<30)
+
+/**
+ * Index in counts for a card, all ten valued cards share the last one
+ */
+static inline int analyzer_rank(Card card) {
+	int rank = CARD_RANK(card);
+	return rank>=10 ? 9 : rank-1;
+}
+
+/**
+ * Counts for a full shoe
+ */
+static void analyzer_full_shoe(Analyzer *analyzer,int counts[ANALYZER_RANKS]) {
+	int i;
+	for (i=0;i<9;i++) {
+		counts[i] = 4*analyzer->num_decks;
+	}
+	counts[9] = 16*analyzer->num_decks;
+}
+
+/**
+ * Packs the counts into one word, 6 bits for A-9 (at most 32 of
+ * each) and 8 bits for the tens (at most 128).
+ */
+static inline uint64_t analyzer_pack(const int counts[ANALYZER_RANKS]) {
+	uint64_t comp = 0;
+	int i;
+	for (i=0;i<9;i++) {
+		comp |= (uint64_t)counts[i] << (6*i);
+	}
+	return comp | ((uint64_t)counts[9] << 54);
+}
+
+static inline uint32_t analyzer_hash(uint64_t comp,uint32_t hand) {
+	uint64_t z = comp ^ ((uint64_t)hand*0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return (uint32_t)(z ^ (z >> 31));
+}
+
+/**
+ * Returns the slot for the key, either the entry already there
+ * or the empty one it goes in.
+ */
+static AnalyzerEntry *analyzer_slot(AnalyzerEntry *memo,int size,uint64_t comp,uint32_t hand) {
+	uint32_t i = analyzer_hash(comp,hand) & (size-1);
+	while (memo[i].hand!=0 && (memo[i].hand!=hand || memo[i].comp!=comp)) {
+		i = (i+1) & (size-1);
+	}
+	return &memo[i];
+}
+
+static bool analyzer_lookup(Analyzer *analyzer,uint64_t comp,uint32_t hand,double dist[ANALYZER_OUTCOMES]) {
+	AnalyzerEntry *entry = analyzer_slot(analyzer->memo,analyzer->_size,comp,hand);
+	analyzer->lookups++;
+	if (entry->hand==0) {
+		return FALSE;
+	}
+	analyzer->hits++;
+	memcpy(dist,entry->dist,sizeof(entry->dist));
+	return TRUE;
+}
+
+static void analyzer_store(Analyzer *analyzer,uint64_t comp,uint32_t hand,const double dist[ANALYZER_OUTCOMES]) {
+	AnalyzerEntry *entry;
+	int i;
+
+	// Keep it at most half full
+	if (2*(analyzer->_num_entries+1)>analyzer->_size) {
+		AnalyzerEntry *old = analyzer->memo;
+		int size = analyzer->_size;
+		analyzer->_size *= 2;
+		analyzer->memo = calloc(analyzer->_size,sizeof(AnalyzerEntry));
+		assert(analyzer->memo != NULL);
+		for (i=0;i<size;i++) {
+			if (old[i].hand!=0) {
+				*analyzer_slot(analyzer->memo,analyzer->_size,old[i].comp,old[i].hand) = old[i];
+			}
+		}
+		free(old);
+	}
+	entry = analyzer_slot(analyzer->memo,analyzer->_size,comp,hand);
+	entry->comp = comp;
+	entry->hand = hand;
+	memcpy(entry->dist,dist,sizeof(entry->dist));
+	analyzer->_num_entries++;
+}
+
+/**
+ * Adds a card with value (ace is 1) to the hand
+ */
+static inline void analyzer_add(int *score,bool *soft,int value) {
+	int hard = *soft ? *score-10 : *score;
+	bool ace = *soft || value==1; // A hard hand with an ace over 11 can't use it
+	hard += value;
+	*soft = (ace && hard<=11);
+	*score = hard + (*soft ? 10 : 0);
+}
+
+Analyzer *analyzer_create(int num_decks) {
+	Analyzer *analyzer = malloc(sizeof(Analyzer));
+	assert(analyzer != NULL);
+	assert(num_decks>=1 && num_decks<=SHOE_MAX_DECKS);
+	analyzer->num_decks = num_decks;
+	analyzer->_size = ANALYZER_MEMO_SIZE;
+	analyzer->memo = calloc(analyzer->_size,sizeof(AnalyzerEntry));
+	assert(analyzer->memo != NULL);
+	analyzer->_num_entries = 0;
+	analyzer->lookups = 0;
+	analyzer->hits = 0;
+	return analyzer;
+}
+
+bool analyzer_destroy(Analyzer *analyzer) {
+	assert(analyzer!=NULL);
+	free(analyzer->memo);
+	free(analyzer);
+	return TRUE;
+}
+
+/**
+ * Forgets everything that was memoized
+ */
+void analyzer_clear(Analyzer *analyzer) {
+	memset(analyzer->memo,0,analyzer->_size*sizeof(AnalyzerEntry));
+	analyzer->_num_entries = 0;
+}
+
+/**
+ * Counts the cards left in the shoe
+ */
+void analyzer_count_shoe(Shoe *shoe,int counts[ANALYZER_RANKS]) {
+	int i;
+	memset(counts,0,ANALYZER_RANKS*sizeof(int));
+	for (i=0;i<shoe->_num_cards;i++) {
+		counts[analyzer_rank(shoe->cards[i])]++;
+	}
+}
+
+/**
+ * Takes cards that have been seen out of the counts
+ */
+void analyzer_remove_cards(const Card *cards,int num_cards,int counts[ANALYZER_RANKS]) {
+	int i;
+	for (i=0;i<num_cards;i++) {
+		assert(counts[analyzer_rank(cards[i])]>0);
+		counts[analyzer_rank(cards[i])]--;
+	}
+}
+
+/**
+ * Fills dist with the odds of the dealer finishing on each of
+ * DEALER_STANDS-21 (dist[score-DEALER_STANDS]) or busting
+ * (dist[ANALYZER_BUST]) from the hand they have now.
+ */
+void analyzer_dealer(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,bool soft,double dist[ANALYZER_OUTCOMES]) {
+	double next[ANALYZER_OUTCOMES];
+	int left[ANALYZER_RANKS];
+	uint32_t hand = ANALYZER_USED | (score<<1) | (soft!=FALSE);
+	uint64_t comp;
+	int i,k,n;
+
+	memset(dist,0,ANALYZER_OUTCOMES*sizeof(double));
+	if (score>21) {
+		dist[ANALYZER_BUST] = 1;
+		return;
+	} else if (score>=DEALER_STANDS) {
+		dist[score-DEALER_STANDS] = 1;
+		return;
+	}
+
+	comp = analyzer_pack(counts);
+	if (analyzer_lookup(analyzer,comp,hand,dist)) {
+		return;
+	}
+
+	memcpy(left,counts,sizeof(left));
+	for (n=0,i=0;i<ANALYZER_RANKS;i++) {
+		n += left[i];
+	}
+	if (n==0) { // Shuffled up a new shoe
+		analyzer_full_shoe(analyzer,left);
+		n = 52*analyzer->num_decks;
+	}
+
+	for (i=0;i<ANALYZER_RANKS;i++) {
+		if (left[i]==0) {
+			continue;
+		}
+		double p = (double)left[i]/n;
+		int next_score = score;
+		bool next_soft = soft;
+		analyzer_add(&next_score,&next_soft,i+1);
+		left[i]--;
+		analyzer_dealer(analyzer,left,next_score,next_soft,next);
+		left[i]++;
+		for (k=0;k<ANALYZER_OUTCOMES;k++) {
+			dist[k] += p*next[k];
+		}
+	}
+	analyzer_store(analyzer,comp,hand,dist);
+}
+
+/**
+ * Expected amount won per unit bet if the player stands on score
+ * with the dealer playing out their hand from the shoe.
+ */
+double analyzer_stand_ev(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,int dealer_score,bool dealer_soft) {
+	double dist[ANALYZER_OUTCOMES];
+	double ev;
+	int k;
+	if (score>21) {
+		return -1;
+	} else if (score==21) { // Any 21 pays 3:2, even against the dealer's 21
+		return 1.5;
+	}
+	analyzer_dealer(analyzer,counts,dealer_score,dealer_soft,dist);
+	ev = dist[ANALYZER_BUST];
+	for (k=0;k<ANALYZER_BUST;k++) {
+		if (score>k+DEALER_STANDS) {
+			ev += dist[k];
+		} else if (score<k+DEALER_STANDS) {
+			ev -= dist[k];
+		}
+	}
+	return ev;
+}
+
+/**
+ * Expected amount won per unit bet if the player takes a card
+ * and then keeps playing the best they can.
+ */
+double analyzer_hit_ev(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,bool soft,int dealer_score,bool dealer_soft) {
+	double ev[ANALYZER_OUTCOMES];
+	int left[ANALYZER_RANKS];
+	uint32_t hand = ANALYZER_USED | ANALYZER_PLAYER | (dealer_score<<7) | ((dealer_soft!=FALSE)<<6) | (score<<1) | (soft!=FALSE);
+	uint64_t comp = analyzer_pack(counts);
+	int i,n;
+
+	if (analyzer_lookup(analyzer,comp,hand,ev)) {
+		return ev[0];
+	}
+	memset(ev,0,sizeof(ev));
+
+	memcpy(left,counts,sizeof(left));
+	for (n=0,i=0;i<ANALYZER_RANKS;i++) {
+		n += left[i];
+	}
+	if (n==0) { // Shuffled up a new shoe
+		analyzer_full_shoe(analyzer,left);
+		n = 52*analyzer->num_decks;
+	}
+
+	for (i=0;i<ANALYZER_RANKS;i++) {
+		if (left[i]==0) {
+			continue;
+		}
+		double p = (double)left[i]/n;
+		double value;
+		int next_score = score;
+		bool next_soft = soft;
+		analyzer_add(&next_score,&next_soft,i+1);
+		left[i]--;
+		if (next_score>21) {
+			value = -1;
+		} else if (next_score==21) { // Can't do better than standing
+			value = 1.5;
+		} else {
+			double stand = analyzer_stand_ev(analyzer,left,next_score,dealer_score,dealer_soft);
+			double hit = analyzer_hit_ev(analyzer,left,next_score,next_soft,dealer_score,dealer_soft);
+			value = hit>stand ? hit : stand;
+		}
+		left[i]++;
+		ev[0] += p*value;
+	}
+	analyzer_store(analyzer,comp,hand,ev);
+	return ev[0];
+}
+
+/**
+ * Works out what standing and hitting are worth for the player in seat
+ * against the dealer (seat 0) with what's left in the shoe. returns TRUE
+ * if hitting is worth more.
+ */
+bool analyzer_advise(Analyzer *analyzer,Shoe *shoe,Seats *seats,int seat,double *stand,double *hit) {
+	int counts[ANALYZER_RANKS];
+	bool dealer_soft = player_is_soft(seats,0);
+	analyzer_count_shoe(shoe,counts);
+	*stand = analyzer_stand_ev(analyzer,counts,seats->score[seat],seats->score[0],dealer_soft);
+	if (seats->busted[seat] || seats->score[seat]==21) {
+		*hit = *stand;
+		return FALSE;
+	}
+	*hit = analyzer_hit_ev(analyzer,counts,seats->score[seat],player_is_soft(seats,seat),seats->score[0],dealer_soft);
+	return *hit>*stand;
+}
+
+/**
+ * Entry point for --analyze, prints the dealer's odds for each up card
+ * and whether to hit or stand from a full shoe of num_decks.
+ */
+int analyzer_main(int num_decks) {
+	Analyzer *analyzer = analyzer_create(num_decks);
+	const char *upcards = "A23456789T";
+	double dist[ANALYZER_OUTCOMES];
+	int full[ANALYZER_RANKS];
+	int counts[ANALYZER_RANKS];
+	struct timespec start,end;
+	long decisions = 0;
+	int up,total,k;
+
+	analyzer_full_shoe(analyzer,full);
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	printf("Dealer outcomes with %i decks:\n",num_decks);
+	printf("-----------------------------------\n");
+	printf("Up     17     18     19     20     21   Bust\n");
+	for (up=0;up<ANALYZER_RANKS;up++) {
+		memcpy(counts,full,sizeof(counts));
+		counts[up]--;
+		analyzer_dealer(analyzer,counts,up==0 ? 11 : up+1,up==0,dist);
+		printf(" %c",upcards[up]);
+		for (k=0;k<ANALYZER_OUTCOMES;k++) {
+			printf(" %6.4f",dist[k]);
+		}
+		printf("\n");
+	}
+
+	// Two card hands, hard ones are a ten and whatever makes the total
+	// and soft ones an ace and whatever makes the total
+	printf("\nHit (H) or stand (S):\n");
+	printf("-----------------------------------\n");
+	printf("           23456789TA\n");
+	for (k=0;k<2;k++) {
+		for (total=(k ? 13 : 12);total<=20;total++) {
+			printf("%s %2i    ",k ? "Soft" : "Hard",total);
+			for (up=1;up<=ANALYZER_RANKS;up++) {
+				int u = up%ANALYZER_RANKS; // Ace last
+				int other = k ? total-11 : total-10;
+				memcpy(counts,full,sizeof(counts));
+				counts[u]--;
+				counts[k ? 0 : 9]--;
+				counts[other-1]--;
+				double stand = analyzer_stand_ev(analyzer,counts,total,u==0 ? 11 : u+1,u==0);
+				double hit = analyzer_hit_ev(analyzer,counts,total,k,u==0 ? 11 : u+1,u==0);
+				printf("%c",hit>stand ? 'H' : 'S');
+				decisions++;
+			}
+			printf("\n");
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	double elapsed = (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+
+	printf("-----------------------------------\n");
+	printf("Decisions:  %li\n",decisions);
+	printf("Memoized:   %i (%0.2f%% of %li lookups found)\n",analyzer->_num_entries,100.0*analyzer->hits/analyzer->lookups,analyzer->lookups);
+	printf("Time:       %0.3fs\n",elapsed);
+	assert(analyzer_destroy(analyzer));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/*
+ * analyzer.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Exact odds from the cards left in the shoe. The dealer's hand is played
+ *  out over every card that could come next, results are memoized on the
+ *  shoe composition and hand so each one is only worked out once.
+ */
+#include <stdint.h>
+#include "blackjack.h"
+
+#ifndef ANALYZER_H_
+#define ANALYZER_H_
+
+// Ranks by value, A,2-9 and 10 for all the ten valued cards
+#ifndef ANALYZER_RANKS
+#define ANALYZER_RANKS 10
+#endif
+
+// Dealer finishes with DEALER_STANDS-21 or busts
+#ifndef ANALYZER_OUTCOMES
+#define ANALYZER_OUTCOMES (21-DEALER_STANDS+2)
+#define ANALYZER_BUST (ANALYZER_OUTCOMES-1)
+#endif
+
+#ifndef AnalyzerEntry
+/**
+ * A memoized result, dist holds the dealer's outcomes or the
+ * player's EV in dist[0].
+ */
+typedef struct AnalyzerEntry {
+	uint64_t comp; // Packed counts of each rank
+	uint32_t hand; // Packed hands being played, 0 is an empty slot
+	double dist[ANALYZER_OUTCOMES];
+} AnalyzerEntry;
+#endif
+
+#ifndef Analyzer
+/**
+ * Works out the odds for a shoe of num_decks
+ */
+typedef struct Analyzer {
+	int num_decks;
+	AnalyzerEntry *memo; // Open addressed hash table
+	int _num_entries;
+	int _size; // Slots in memo, a power of two
+	long lookups;
+	long hits; // Lookups found in the memo
+} Analyzer;
+#endif
+
+Analyzer *analyzer_create(int num_decks);
+bool analyzer_destroy(Analyzer *analyzer);
+void analyzer_clear(Analyzer *analyzer);
+void analyzer_count_shoe(Shoe *shoe,int counts[ANALYZER_RANKS]);
+void analyzer_remove_cards(const Card *cards,int num_cards,int counts[ANALYZER_RANKS]);
+void analyzer_dealer(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,bool soft,double dist[ANALYZER_OUTCOMES]);
+double analyzer_stand_ev(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,int dealer_score,bool dealer_soft);
+double analyzer_hit_ev(Analyzer *analyzer,const int counts[ANALYZER_RANKS],int score,bool soft,int dealer_score,bool dealer_soft);
+bool analyzer_advise(Analyzer *analyzer,Shoe *shoe,Seats *seats,int seat,double *stand,double *hit);
+int analyzer_main(int num_decks);
+
+#endif /* ANALYZER_H_ */
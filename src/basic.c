@@ -0,0 +1,89 @@
+/*
+ * basic.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Hit/stand basic strategy for a dealer that stands on all 17s. There
+ *  is no doubling or splitting in this game so only those two plays are
+ *  in the table.
+ */
+#include <assert.h>
+#include "blackjack.h"
+#include "basic.h"
+
+/**
+ * What to do indexed by [soft][score][value of the dealer's up card], H
+ * to hit and S to stand. Up cards go 2-10 and 11 for an ace so the first
+ * two columns are never used, a hard total under 4 can't happen.
+ */
+static const char basic_table[2][22][13] = {
+	{ // Hard   ..23456789TA
+		[0]  = "HHHHHHHHHHHH",
+		[1]  = "HHHHHHHHHHHH",
+		[2]  = "HHHHHHHHHHHH",
+		[3]  = "HHHHHHHHHHHH",
+		[4]  = "HHHHHHHHHHHH",
+		[5]  = "HHHHHHHHHHHH",
+		[6]  = "HHHHHHHHHHHH",
+		[7]  = "HHHHHHHHHHHH",
+		[8]  = "HHHHHHHHHHHH",
+		[9]  = "HHHHHHHHHHHH",
+		[10] = "HHHHHHHHHHHH",
+		[11] = "HHHHHHHHHHHH",
+		[12] = "HHHHSSSHHHHH",
+		[13] = "HHSSSSSHHHHH",
+		[14] = "HHSSSSSHHHHH",
+		[15] = "HHSSSSSHHHHH",
+		[16] = "HHSSSSSHHHHH",
+		[17] = "SSSSSSSSSSSS",
+		[18] = "SSSSSSSSSSSS",
+		[19] = "SSSSSSSSSSSS",
+		[20] = "SSSSSSSSSSSS",
+		[21] = "SSSSSSSSSSSS",
+	},
+	{ // Soft   ..23456789TA, the lowest is two aces (12)
+		[0]  = "HHHHHHHHHHHH",
+		[1]  = "HHHHHHHHHHHH",
+		[2]  = "HHHHHHHHHHHH",
+		[3]  = "HHHHHHHHHHHH",
+		[4]  = "HHHHHHHHHHHH",
+		[5]  = "HHHHHHHHHHHH",
+		[6]  = "HHHHHHHHHHHH",
+		[7]  = "HHHHHHHHHHHH",
+		[8]  = "HHHHHHHHHHHH",
+		[9]  = "HHHHHHHHHHHH",
+		[10] = "HHHHHHHHHHHH",
+		[11] = "HHHHHHHHHHHH",
+		[12] = "HHHHHHHHHHHH",
+		[13] = "HHHHHHHHHHHH",
+		[14] = "HHHHHHHHHHHH",
+		[15] = "HHHHHHHHHHHH",
+		[16] = "HHHHHHHHHHHH",
+		[17] = "HHHHHHHHHHHH",
+		[18] = "SSSSSSSSSHHH",
+		[19] = "SSSSSSSSSSSS",
+		[20] = "SSSSSSSSSSSS",
+		[21] = "SSSSSSSSSSSS",
+	},
+};
+
+/**
+ * Returns TRUE if basic strategy hits score (soft if an ace
+ * is counted as 11) against the dealer's up card.
+ */
+bool basic_hit(int score,bool soft,Card upcard) {
+	assert(score>=0);
+	if (score>21) {
+		return FALSE;
+	}
+	return basic_table[soft!=FALSE][score][card_value(upcard)]=='H';
+}
+
+/**
+ * Same as basic_hit() for the player in seat using the dealer's
+ * (seat 0) first card as the up card
+ */
+bool basic_player_hit(Seats *seats,int seat) {
+	return basic_hit(seats->score[seat],player_is_soft(seats,seat),seats->cards[0][0]);
+}
@@ -0,0 +1,18 @@
+/*
+ * basic.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Basic strategy for hit or stand, looked up from a fixed table
+ *  by the player's total and the dealer's up card.
+ */
+#include "blackjack.h"
+
+#ifndef BASIC_H_
+#define BASIC_H_
+
+bool basic_hit(int score,bool soft,Card upcard);
+bool basic_player_hit(Seats *seats,int seat);
+
+#endif /* BASIC_H_ */
@@ -0,0 +1,452 @@
+/*
+ * bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Benchmarks of the game's hot paths, only built by the Benchmark
+ *  configuration (which defines BLACKJACK_BENCHMARK and leaves out the
+ *  game's main). Everything uses fixed seeds so runs can be compared.
+ *
+ *   Usage:
+ *      blackjack-bench [<name filter>]
+ *
+ *  Prints one CSV line per benchmark:
+ *      benchmark,iterations,ns_per_op,ops_per_sec
+ */
+#ifdef BLACKJACK_BENCHMARK
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "restart.h"
+#include "blackjack.h"
+#include "simulator.h"
+#include "hands.h"
+
+#define BENCH_SEED 42
+#define BENCH_DECKS 6
+#define BENCH_HANDS 4096 // Hands in the batch benchmarks
+#define BENCH_CHECK_HITS 4 // Cards the player may take in the hands check
+
+static volatile long bench_sink; // So the compiler can't drop the work
+
+static double bench_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return now.tv_sec+now.tv_nsec/1e9;
+}
+
+static void bench_report(const char *name,long ops,double seconds) {
+	printf("%s,%li,%0.2f,%0.0f\n",name,ops,1e9*seconds/ops,ops/seconds);
+	fflush(stdout);
+}
+
+static Shoe *bench_shoe(Rng *rng) {
+	assert(rng_init(rng,RNG_XOSHIRO,BENCH_SEED));
+	Shoe *shoe = shoe_create(BENCH_DECKS,0.75,rng);
+	assert(shoe_init(shoe));
+	assert(shoe_shuffle(shoe));
+	return shoe;
+}
+
+// ========================================= SHOE =================================================
+
+static void bench_shoe_init(const char *name,long n) {
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	long i;
+	double start = bench_now();
+	for (i=0;i<n;i++) {
+		shoe_init(shoe);
+		bench_sink += shoe->cards[i%shoe->_size];
+	}
+	bench_report(name,n,bench_now()-start);
+	assert(shoe_destroy(shoe));
+}
+
+static void bench_shoe_shuffle(const char *name,long n) {
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	long i;
+	double start = bench_now();
+	for (i=0;i<n;i++) {
+		shoe_shuffle(shoe);
+		bench_sink += shoe->cards[0];
+	}
+	bench_report(name,n,bench_now()-start);
+	assert(shoe_destroy(shoe));
+}
+
+// ========================================= SHOE =================================================
+
+// ========================================= PLAYER =================================================
+
+/**
+ * Scores three card hands, one op is a whole hand
+ */
+static void bench_player_hit(const char *name,long n) {
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	Seats seats;
+	long i;
+	int c=0;
+	player_create(&seats,1,1);
+	double start = bench_now();
+	for (i=0;i<n;i++) {
+		player_init_round(&seats,1);
+		player_hit(&seats,1,shoe->cards[c]);
+		player_hit(&seats,1,shoe->cards[c+1]);
+		player_hit(&seats,1,shoe->cards[c+2]);
+		bench_sink += seats.score[1];
+		c = (c+3<shoe->_size-3) ? c+3 : 0;
+	}
+	bench_report(name,n,bench_now()-start);
+	assert(shoe_destroy(shoe));
+}
+
+/**
+ * Compares dealt hands against the dealer at seat 0
+ */
+static void bench_player_cmp(const char *name,long n) {
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	Seats *tables = malloc(64*sizeof(Seats));
+	long i;
+	int t,seat;
+	assert(tables!=NULL);
+	for (t=0;t<64;t++) {
+		for (seat=0;seat<SEATS_MAX;seat++) {
+			player_create(&tables[t],seat,seat);
+			player_hit(&tables[t],seat,shoe_draw(shoe));
+			player_hit(&tables[t],seat,shoe_draw(shoe));
+		}
+	}
+	double start = bench_now();
+	for (i=0;i<n;i++) {
+		bench_sink += player_cmp(&tables[i&63],1+i%(SEATS_MAX-1),0);
+	}
+	bench_report(name,n,bench_now()-start);
+	free(tables);
+	assert(shoe_destroy(shoe));
+}
+
+// ========================================= PLAYER =================================================
+
+// ========================================= HANDS =================================================
+
+static void bench_hands_fill(Hands *hands,Hands *dealers,int16_t deltas[3][BENCH_HANDS]) {
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	Seats seats;
+	int i,j;
+	player_create(&seats,0,0);
+	player_create(&seats,1,1);
+	hands_clear(hands,BENCH_HANDS);
+	hands_clear(dealers,BENCH_HANDS);
+	for (i=0;i<BENCH_HANDS;i++) {
+		player_init_round(&seats,0);
+		player_init_round(&seats,1);
+		for (j=0;j<2;j++) {
+			player_hit(&seats,0,shoe_draw(shoe));
+			player_hit(&seats,1,shoe_draw(shoe));
+		}
+		hands_set(dealers,i,&seats,0);
+		hands_set(hands,i,&seats,1);
+		for (j=0;j<3;j++) {
+			deltas[j][i] = hands_delta(shoe_draw(shoe));
+		}
+	}
+	assert(shoe_destroy(shoe));
+}
+
+/**
+ * Deals the same cards with player_hit() and with hands_hit() on every
+ * version the cpu has, then compares them with player_cmp() and
+ * hands_cmp(). The batch versions must give exactly the same results as
+ * the game, so any difference fails the run. One op is a hand checked
+ * on one version.
+ */
+static void bench_hands_check(const char *name,long n) {
+	static const HandsPath paths[] = {HANDS_SCALAR,HANDS_SSE2,HANDS_AVX2};
+	static const char *path_names[] = {"scalar","sse2","avx2"};
+	static Card cards[BENCH_CHECK_HITS][BENCH_HANDS]; // 0 for no card
+	static int16_t deltas[BENCH_HANDS];
+	Hands *hands = hands_create(BENCH_HANDS);
+	Hands *dealers = hands_create(BENCH_HANDS);
+	Seats *dealt = malloc(BENCH_HANDS*sizeof(Seats)); // Dealer at 0, player at 1
+	Seats *seats = malloc(BENCH_HANDS*sizeof(Seats));
+	Rng rng;
+	Shoe *shoe = bench_shoe(&rng);
+	long checked = 0;
+	long b;
+	int p,i,j;
+	assert(dealt!=NULL && seats!=NULL);
+	double start = bench_now();
+	for (b=0;b<n;b+=BENCH_HANDS) {
+		// The dealer plays out their hand, the player gets two cards
+		// and then maybe a card on each hit
+		for (i=0;i<BENCH_HANDS;i++) {
+			player_create(&dealt[i],0,0);
+			player_create(&dealt[i],1,1);
+			for (j=0;j<2;j++) {
+				player_hit(&dealt[i],0,shoe_draw(shoe));
+				player_hit(&dealt[i],1,shoe_draw(shoe));
+			}
+			while (dealt[i].score[0]<DEALER_STANDS) {
+				player_hit(&dealt[i],0,shoe_draw(shoe));
+			}
+			for (j=0;j<BENCH_CHECK_HITS;j++) {
+				cards[j][i] = rng_bounded(&rng,4) ? shoe_draw(shoe) : 0;
+			}
+		}
+		for (p=0;p<sizeof(paths)/sizeof(*paths);p++) {
+			if (!hands_use(paths[p])) { // Not on this cpu
+				continue;
+			}
+			memcpy(seats,dealt,BENCH_HANDS*sizeof(Seats));
+			hands_clear(hands,BENCH_HANDS);
+			hands_clear(dealers,BENCH_HANDS);
+			for (i=0;i<BENCH_HANDS;i++) {
+				hands_set(dealers,i,&seats[i],0);
+				hands_set(hands,i,&seats[i],1);
+			}
+			for (j=0;j<BENCH_CHECK_HITS;j++) {
+				for (i=0;i<BENCH_HANDS;i++) {
+					deltas[i] = cards[j][i] ? hands_delta(cards[j][i]) : 0;
+					if (cards[j][i]) {
+						player_hit(&seats[i],1,cards[j][i]);
+					}
+				}
+				hands_hit(hands,deltas);
+				for (i=0;i<BENCH_HANDS;i++) {
+					if (hands->hard[i]!=seats[i]._hard[1] || hands->aces[i]!=seats[i]._num_aces[1] ||
+							hands->score[i]!=seats[i].score[1] || hands->busted[i]!=seats[i].busted[1]) {
+						fprintf(stderr,"%s: hands_hit (%s) differs from player_hit at hand %i\n",name,path_names[p],i);
+						exit(EXIT_FAILURE);
+					}
+				}
+			}
+			hands_cmp(hands,dealers);
+			for (i=0;i<BENCH_HANDS;i++) {
+				if (hands->outcome[i]!=player_cmp(&seats[i],1,0)) {
+					fprintf(stderr,"%s: hands_cmp (%s) differs from player_cmp at hand %i\n",name,path_names[p],i);
+					exit(EXIT_FAILURE);
+				}
+			}
+			checked += BENCH_HANDS;
+		}
+	}
+	bench_report(name,checked,bench_now()-start);
+	assert(hands_use(HANDS_AUTO));
+	free(dealt);
+	free(seats);
+	assert(shoe_destroy(shoe));
+	assert(hands_destroy(hands));
+	assert(hands_destroy(dealers));
+}
+
+/**
+ * Deals three cards to every hand in the batch, one op is a hand
+ */
+static void bench_hands_hit(const char *name,long n) {
+	Hands *hands = hands_create(BENCH_HANDS);
+	Hands *dealers = hands_create(BENCH_HANDS);
+	static int16_t deltas[3][BENCH_HANDS];
+	long i;
+	bench_hands_fill(hands,dealers,deltas);
+	double start = bench_now();
+	for (i=0;i<n;i+=BENCH_HANDS) {
+		hands_clear(hands,BENCH_HANDS);
+		hands_hit(hands,deltas[0]);
+		hands_hit(hands,deltas[1]);
+		hands_hit(hands,deltas[2]);
+		bench_sink += hands->score[i&(BENCH_HANDS-1)];
+	}
+	bench_report(name,i,bench_now()-start);
+	assert(hands_destroy(hands));
+	assert(hands_destroy(dealers));
+}
+
+static void bench_hands_cmp(const char *name,long n) {
+	Hands *hands = hands_create(BENCH_HANDS);
+	Hands *dealers = hands_create(BENCH_HANDS);
+	static int16_t deltas[3][BENCH_HANDS];
+	long i;
+	bench_hands_fill(hands,dealers,deltas);
+	double start = bench_now();
+	for (i=0;i<n;i+=BENCH_HANDS) {
+		hands_cmp(hands,dealers);
+		bench_sink += hands->outcome[i&(BENCH_HANDS-1)];
+	}
+	bench_report(name,i,bench_now()-start);
+	assert(hands_destroy(hands));
+	assert(hands_destroy(dealers));
+}
+
+// ========================================= HANDS =================================================
+
+// ========================================= IO =================================================
+
+/**
+ * Forks a process that writes n short lines (like a player's answers)
+ * into a pipe. returns the read end.
+ */
+static int bench_line_writer(long n,pid_t *pid) {
+	int fd[2];
+	char lines[4096];
+	long i;
+	assert(pipe(fd)!=-1);
+	fflush(stdout);
+	*pid = fork();
+	assert(*pid!=-1);
+	if (*pid==0) {
+		r_close(fd[0]);
+		for (i=0;i<(long)sizeof(lines);i+=2) {
+			lines[i] = 'y';
+			lines[i+1] = '\n';
+		}
+		for (i=0;i<n;i+=sizeof(lines)/2) {
+			long num = (n-i<(long)sizeof(lines)/2) ? n-i : (long)sizeof(lines)/2;
+			if (r_write(fd[1],lines,2*num)==-1) {
+				break;
+			}
+		}
+		exit(0);
+	}
+	r_close(fd[1]);
+	return fd[0];
+}
+
+static void bench_r_readline(const char *name,long n) {
+	char line[64];
+	pid_t pid;
+	long i;
+	int fd = bench_line_writer(n,&pid);
+	double start = bench_now();
+	for (i=0;i<n && r_readline(fd,line,sizeof(line))>0;i++) {
+		bench_sink += line[0];
+	}
+	bench_report(name,i,bench_now()-start);
+	r_close(fd);
+	r_waitpid(pid,NULL,0);
+}
+
+static void bench_r_readline_buffered(const char *name,long n) {
+	RLineBuf lb;
+	char line[64];
+	pid_t pid;
+	long i;
+	r_linebuf_init(&lb,bench_line_writer(n,&pid));
+	double start = bench_now();
+	for (i=0;i<n && r_readline_buffered(&lb,line,sizeof(line))>0;i++) {
+		bench_sink += line[0];
+	}
+	bench_report(name,i,bench_now()-start);
+	r_close(lb.fd);
+	r_waitpid(pid,NULL,0);
+}
+
+/**
+ * Asks a player process that plays by itself if it wants to hit,
+ * one op is the request and its reply.
+ */
+static void bench_client_round_trip(const char *name,long n,ClientTransport transport) {
+	Client *client = client_create(1,transport,strategy_find("stand"));
+	Seats seats;
+	Message msg,reply;
+	long i;
+	player_create(&seats,0,0);
+	player_create(&seats,1,1);
+	player_hit(&seats,0,card_create(10,HEARTS));
+	player_hit(&seats,1,card_create(6,CLUBS));
+	player_hit(&seats,1,card_create(CARD_KING,SPADES));
+	double start = bench_now();
+	for (i=0;i<n;i++) {
+		message_init(&msg,MSG_HIT,1);
+		message_set_cards(&msg,&seats,1);
+		assert(client_ask(client,&msg));
+		assert(client_recv(client,&reply));
+		bench_sink += reply.decision;
+	}
+	bench_report(name,n,bench_now()-start);
+	message_init(&msg,MSG_EXIT,1);
+	client_send(client,&msg);
+	r_waitpid(client->pid,NULL,0);
+	assert(client_destroy(client));
+}
+
+static void bench_client_pipe(const char *name,long n) {
+	bench_client_round_trip(name,n,CLIENT_PIPE);
+}
+
+static void bench_client_shm(const char *name,long n) {
+	bench_client_round_trip(name,n,CLIENT_SHM);
+}
+
+// ========================================= IO =================================================
+
+// ========================================= END TO END =================================================
+
+/**
+ * Full rounds at a 6 player table playing basic strategy, one op is a
+ * player hand.
+ */
+static void bench_sim_hands(const char *name,long n) {
+	Strategy *strategies[SEATS_MAX];
+	SimStats stats;
+	Rng rng;
+	int i;
+	memset(&stats,0,sizeof(stats));
+	assert(rng_init(&rng,RNG_XOSHIRO,BENCH_SEED));
+	Blackjack *game = blackjack_create(SEATS_MAX,BENCH_DECKS,0.75,&rng);
+	for (i=1;i<game->_num_players;i++) {
+		game->seats.money[i] = MONEY(1000000);
+		strategies[i] = strategy_find("basic");
+	}
+	double start = bench_now();
+	assert(sim_run(game,strategies,n/(SEATS_MAX-1),&stats));
+	bench_report(name,stats.hands,bench_now()-start);
+	bench_sink += stats.net;
+	assert(blackjack_destroy(game));
+}
+
+// ========================================= END TO END =================================================
+
+typedef struct Benchmark {
+	char *name;
+	void (*run)(const char *name,long n);
+	long n; // Ops to run
+} Benchmark;
+
+static Benchmark benchmarks[] = {
+	{"shoe_init",bench_shoe_init,200000},
+	{"shoe_shuffle",bench_shoe_shuffle,50000},
+	{"player_hit",bench_player_hit,20000000},
+	{"player_cmp",bench_player_cmp,50000000},
+	{"hands_check",bench_hands_check,1048576},
+	{"hands_hit",bench_hands_hit,100000000},
+	{"hands_cmp",bench_hands_cmp,100000000},
+	{"r_readline",bench_r_readline,1000000},
+	{"r_readline_buffered",bench_r_readline_buffered,1000000},
+	{"client_pipe_round_trip",bench_client_pipe,100000},
+	{"client_shm_round_trip",bench_client_shm,100000},
+	{"sim_basic_hands",bench_sim_hands,6000000},
+};
+
+int main(int argc, char *argv[]) {
+	const char *filter = (argc>1) ? argv[1] : "";
+	int i;
+	printf("benchmark,iterations,ns_per_op,ops_per_sec\n");
+	for (i=0;i<sizeof(benchmarks)/sizeof(Benchmark);i++) {
+		if (strstr(benchmarks[i].name,filter)!=NULL) {
+			benchmarks[i].run(benchmarks[i].name,benchmarks[i].n);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif /* BLACKJACK_BENCHMARK */
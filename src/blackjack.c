@@ -30,7 +30,7 @@
  *            * Tell the dealer decision (stay or hit)
  *
  *   Usage Clause:
- *      blackjack <number_of_players>
+ *      blackjack [--simulate <rounds>] [--strategy <name>] [--threads <n>] [--decks <1-8>] [--penetration <0-1>] [--seed <n>] [--rng <xoshiro|pcg>] [--timeout <seconds>] [--tables <n>] [--transport <pipe|shm>] [--history <file>] [--metrics <socket>] [--replay <file>] [--bet <amount>] [--think <ms>] [--rounds <n>] [--quiet] [--analyze] [--advise] <number_of_players>
  *
  *   Notes
  *     - Do not implement the blackjack concepts of double-down or splitting.
@@ -38,152 +38,265 @@
  *     - Any non-reentrant function that is interrupted by a signal must be restarted.
  */
 #include <errno.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <time.h>
 #include <math.h>
+#include <getopt.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
 #include "restart.h"
 #include "helpers.h"
+#include "rng.h"
+#include "blackjack.h"
+#include "simulator.h"
+#include "table.h"
+#include "analyzer.h"
+#include "history.h"
+#include "latency.h"
+#include "replay.h"
+#include "bot.h"
 
 
 // ========================================= CARD =================================================
 
-// I guess this is irrelevant to blackjack but whatever
-#ifndef Suite
-typedef enum { CLUBS,DIAMONDS,HEARTS,SPADES } Suite;
-#endif
+// Lookup tables indexed by the rank of a card
+static const int card_values[CARD_KING+1] = {0,11,2,3,4,5,6,7,8,9,10,10,10,10}; // If score over 21 an ace is 1
+
+// Every card already formatted, indexed by suite then rank
+#define CARD_GLYPHS(s) {"?" s,"A" s,"2" s,"3" s,"4" s,"5" s,"6" s,"7" s,"8" s,"9" s,"10" s,"J" s,"Q" s,"K" s}
+//static const char *suites[4] = {"Clubs","Diamonds","Hearts","Spades"};
+static const char card_glyphs[4][CARD_KING+1][CARD_STR_MAX] = {CARD_GLYPHS("C"),CARD_GLYPHS("D"),CARD_GLYPHS("H"),CARD_GLYPHS("S")};
+static const unsigned char card_glyph_lens[CARD_KING+1] = {2,2,2,2,2,2,2,2,2,2,3,2,2,2};
+
+Card card_create(int rank,Suite suite) {
+	assert(rank>=CARD_ACE && rank<=CARD_KING);
+	return (Card)((suite<<4)|rank);
+}
 
-#ifndef Card
 /**
- * Representation of a card
+ * Writes the card like "10H" into buf without allocating. Works like
+ * snprintf, returns the length of the whole string even if it was cut short.
  */
-typedef struct Card {
-	Suite suite; // just for kicks
-	char *name;
-	int values[2]; // If score over 21 use value 2
-} Card;
-Card *card_create(char *name,Suite suite,int val0,int val1);
-bool card_destroy(Card *card);
-bool card_is_ace(Card *card);
-char *card_to_str(Card *card);
-#endif
+int card_format(Card card,char *buf,size_t size) {
+	int n = card_glyph_lens[CARD_RANK(card)];
+	if (size>0) {
+		size_t len = ((size_t)n<size) ? (size_t)n : size-1;
+		memcpy(buf,card_glyphs[CARD_SUITE(card)][CARD_RANK(card)],len);
+		buf[len] = '\0';
+	}
+	return n;
+}
 
-Card *card_create(char *name,Suite suite,int val0,int val1) {
-	Card *card = malloc(sizeof(Card));
-	assert(card != NULL);
-	card->name = name;
-	card->suite = suite;
-	card->values[0] = val0;
-	card->values[1] = val1;
-	return card;
+bool card_is_ace(Card card) {
+	return CARD_RANK(card)==CARD_ACE;
 }
 
-char *card_to_str(Card *card) {
-	char *str;
-	//char *suites[4] = {"Clubs","Diamonds","Hearts","Spades"};
-	//assert(asprintf(&str,"Card(name=%s,suite=%s,values=[%i,%i])",card->name,suites[card->suite],card->values[0],card->values[1])>0);
-	char *suites[4] = {"C","D","H","S"};
-	assert(asprintf(&str,"%s%s",card->name,suites[card->suite])>0);
-	return str;
+/**
+ * Returns the value of the card counting aces as 11
+ */
+int card_value(Card card) {
+	return card_values[CARD_RANK(card)];
 }
 
-bool card_is_ace(Card *card) {
-	if (strcmp(card->name,"A")==0) {
-		return TRUE;
+// ========================================= CARD =================================================
+
+// ========================================= SHOE =================================================
+
+/**
+ * Creates a shoe with the given number of decks. The cut card is placed
+ * so that penetration (0-1] of the shoe is dealt before it's shuffled.
+ */
+Shoe *shoe_create(int num_decks,double penetration,Rng *rng) {
+	assert(num_decks>=1 && num_decks<=SHOE_MAX_DECKS);
+	assert(penetration>0 && penetration<=1);
+	Shoe *shoe = malloc(sizeof(Shoe));
+	assert(shoe != NULL);
+	shoe->num_decks = num_decks;
+	shoe->rng = rng;
+	shoe->_size = num_decks*52;
+	shoe->cards = malloc(shoe->_size*sizeof(Card));
+	assert(shoe->cards != NULL);
+	shoe->cut = shoe->_size-(int)(penetration*shoe->_size);
+	shoe->_num_cards = 0; // Empty so the first round shuffles
+	shoe->shuffles = 0;
+	return shoe;
+}
+
+bool shoe_destroy(Shoe *shoe) {
+	assert(shoe!=NULL);
+	free(shoe->cards);
+	free(shoe);
+	return TRUE;
+}
+
+/**
+ * Fill the shoe with all the decks
+ */
+bool shoe_init(Shoe *shoe) {
+	int deck,rank,suite;
+	shoe->_num_cards=0;
+	for (deck=0;deck<shoe->num_decks;deck++) {
+		for (suite=CLUBS;suite<=SPADES;suite++) {
+			for (rank=CARD_ACE;rank<=CARD_KING;rank++) {
+				shoe->cards[shoe->_num_cards] = card_create(rank,suite);
+				shoe->_num_cards++;
+			}
+		}
 	}
-	return FALSE;
+	return TRUE;
 }
 
-bool card_destroy(Card *card) {
-	assert(card!=NULL);
-	free(card->name);
-	free(card);
+/**
+ * Shuffle the cards left in the shoe by randomly sorting the indexes of the cards
+ * (Fisher-Yates) based on: http://stackoverflow.com/questions/6127503/shuffle-array-in-c
+ */
+bool shoe_shuffle(Shoe *shoe) {
+	assert(shoe->_num_cards>0);
+	Card tmp;
+	int i;
+	for (i=0;i<shoe->_num_cards-1;i++) {
+		// Pick a random index
+		int j = i + rng_bounded(shoe->rng,shoe->_num_cards - i);
+		// Swap the two cards
+		tmp = shoe->cards[j];
+		shoe->cards[j] = shoe->cards[i];
+		shoe->cards[i] = tmp;
+	}
+	shoe->shuffles++;
 	return TRUE;
 }
 
-// ========================================= CARD =================================================
+/**
+ * Returns TRUE once the cut card has come out
+ */
+bool shoe_needs_shuffle(Shoe *shoe) {
+	return shoe->_num_cards<=shoe->cut;
+}
 
-// ========================================= PLAYER =================================================
+/**
+ * Takes a card from the top of the shoe. The cut card normally stops the
+ * shoe from running dry but if it does a fresh shoe is shuffled in.
+ */
+Card shoe_draw(Shoe *shoe) {
+	if (shoe->_num_cards==0) {
+		assert(shoe_init(shoe));
+		assert(shoe_shuffle(shoe));
+	}
+	shoe->_num_cards--;
+	return shoe->cards[shoe->_num_cards];
+}
 
-#ifndef Player
-/**
- * Representation of a Player
- */
-typedef struct Player {
-	int id; // index in player array
-	Card *cards[21]; // Cards the player has, could have up to 21
-	int _num_cards;
-	int _num_games;
-	int score;
-	double money;
-	double bet;
-	bool busted;
-} Player;
-Player *player_create(int id);
-bool player_destroy(Player *player);
-bool player_init_round(Player *player);
-char *player_cards_to_str(Player *player);
-char *player_to_str(Player *player);
-bool player_hit(Player *player,Card *card);
-int player_cmp(Player *player,Player *dealer);
-#endif
+// ========================================= SHOE =================================================
 
-Player *player_create(int id) {
-	Player *player = malloc(sizeof(Player));
-	assert(player != NULL);
-	player->id = id;
-	player->_num_cards = 0;
-	player->score = 0;
-	player->money = 0.0;
-	player->bet = 0.0;
-	player->busted = FALSE;
-	player->_num_games = 0;
-	return player;
+// ========================================= MONEY =================================================
+
+/**
+ * Reads an amount in dollars like "12" or "12.50", anything
+ * past the cents is ignored. returns -1 if it's more than MONEY_MAX
+ * either way, 0 if it isn't a number.
+ */
+Money money_parse(const char *str) {
+	char *end;
+	Money cents = 0;
+	while (isspace((unsigned char)*str)) {
+		str++;
+	}
+	bool negative = (*str=='-');
+	errno = 0;
+	Money dollars = strtoll(str,&end,10);
+	if (errno==ERANGE || dollars>MONEY_MAX/100 || dollars<-MONEY_MAX/100) {
+		return -1;
+	}
+	if (dollars<0) {
+		dollars = -dollars;
+	}
+	if (*end=='.' && isdigit((unsigned char)end[1])) {
+		cents = (end[1]-'0')*10;
+		if (isdigit((unsigned char)end[2])) {
+			cents += end[2]-'0';
+		}
+	}
+	cents += MONEY(dollars);
+	if (cents>MONEY_MAX) { // eg MONEY_MAX and some cents
+		return -1;
+	}
+	return negative ? -cents : cents;
+}
+
+// ========================================= MONEY =================================================
+
+// ========================================= PLAYER =================================================
+
+/**
+ * Sits player id down in the seat with nothing
+ */
+void player_create(Seats *seats,int seat,int id) {
+	assert(seat>=0 && seat<SEATS_MAX);
+	seats->id[seat] = id;
+	seats->money[seat] = 0;
+	assert(player_init_round(seats,seat));
 }
 
 /**
  * Resets the player so a new game can be played
  */
-bool player_init_round(Player *player) {
-	player->busted = FALSE;
-	player->score = 0;
-	player->bet = 0;
+bool player_init_round(Seats *seats,int seat) {
+	seats->busted[seat] = FALSE;
+	seats->blackjack[seat] = FALSE;
+	seats->score[seat] = 0;
+	seats->bet[seat] = 0;
 
 	// Clear any cards they have
-	while(player->_num_cards>0) {
-		player->_num_cards--;
-		player->cards[player->_num_cards] = NULL;
-	}
+	seats->_num_cards[seat] = 0;
+	seats->_num_aces[seat] = 0;
+	seats->_hard[seat] = 0;
 
 	return TRUE;
 }
 
-char *player_cards_to_str(Player *player) {
-	// Print the cards
-	int i;
-	char *buf = "[";
-	for (i=0;i<player->_num_cards;i++) {
-		asprintf(&buf,"%s%s",buf,card_to_str(player->cards[i]));
-		if(i!=player->_num_cards-1) {asprintf(&buf,"%s,",buf);}
+/**
+ * Writes the cards like "[AS,10H]" into buf without allocating. Works
+ * like snprintf, SEATS_CARDS_STR_MAX is always enough room.
+ */
+int player_cards_format(Seats *seats,int seat,char *buf,size_t size) {
+	int i,n=0;
+	char tmp[SEATS_CARDS_STR_MAX];
+	char *p = (size>=SEATS_CARDS_STR_MAX) ? buf : tmp; // Only copy when it might not fit
+	p[n++] = '[';
+	for (i=0;i<seats->_num_cards[seat];i++) {
+		Card card = seats->cards[seat][i];
+		if (i>0) {p[n++] = ',';}
+		memcpy(p+n,card_glyphs[CARD_SUITE(card)][CARD_RANK(card)],CARD_STR_MAX);
+		n += card_glyph_lens[CARD_RANK(card)];
 	}
-	assert(asprintf(&buf,"%s]",buf)>0);
-	return buf;
-}
-
-char *player_to_str(Player *player) {
-	char *str;
-	char *bools[2] = {"False","True"};
-	assert(asprintf(&str,"Player(id=%i,score=%i,money=%0.2f,busted=%s,cards=%s)",player->id,player->score,player->money,bools[player->busted],player_cards_to_str(player))>0);
-	return str;
+	p[n++] = ']';
+	p[n] = '\0';
+	if (p==tmp && size>0) {
+		size_t len = ((size_t)n<size) ? (size_t)n : size-1;
+		memcpy(buf,tmp,len);
+		buf[len] = '\0';
+	}
+	return n;
 }
 
-bool player_destroy(Player *player) {
-	assert(player!=NULL);
-	free(player);
-	return TRUE;
+/**
+ * Writes a description of the player into buf without allocating,
+ * returns the same as snprintf.
+ */
+int player_format(Seats *seats,int seat,char *buf,size_t size) {
+	static const char *bools[2] = {"False","True"};
+	char cards[SEATS_CARDS_STR_MAX];
+	player_cards_format(seats,seat,cards,sizeof(cards));
+	return snprintf(buf,size,"Player(id=%i,score=%i,money=" MONEY_FMT ",busted=%s,cards=%s)",seats->id[seat],seats->score[seat],MONEY_ARGS(seats->money[seat]),bools[seats->busted[seat]],cards);
 }
 
 /**
@@ -191,49 +304,38 @@ bool player_destroy(Player *player) {
  * 1. Add a card to the players set
  * 2. Updates their score
  * 3. Set the busted flag (if applicable).
+ *
+ * The score is kept as a running hard total (aces count as 1) and a count
+ * of aces so each card is O(1). At most one ace can ever count as 11.
  */
-bool player_hit(Player *player,Card *card) {
-	int i= 0;
-	int j = 0;
-	player->score = 0;
-	int num_aces = 0;
-
+bool player_hit(Seats *seats,int seat,Card card) {
 	// Cannot hit, they already busted
-	if (player->busted) {
+	if (seats->busted[seat]) {
 		return FALSE;
 	}
+	assert(seats->_num_cards[seat]<SEATS_MAX_CARDS);
 
 	// Get another card
-	player->cards[player->_num_cards] = card;
-	player->_num_cards ++;
-
-	// Calculate score and set busted flag
-	for (i=0;i<player->_num_cards;i++){
-		player->score += player->cards[i]->values[0];
-	}
-
-	// If their score is over 21 and they have
-	// an ace, recalculate the score
-	num_aces = player_count_aces(player);
-	if (player->score>21 && num_aces>0) {
-		for(j=1;j<num_aces && player->score>21;j++) { // while still busted
-			player->score = 0; // reset
-			int aces_used = 0;
-
-			// recalculate score
-			for (i=0;i<player->_num_cards;i++){
-				if (card_is_ace(player->cards[i]) && aces_used<j) {
-					aces_used++;
-					player->score += player->cards[i]->values[1];
-				} else {
-					player->score += player->cards[i]->values[0];
-				}
-			}
-		}
+	seats->cards[seat][seats->_num_cards[seat]] = card;
+	seats->_num_cards[seat]++;
+
+	// Update the hard total
+	if (card_is_ace(card)) {
+		seats->_num_aces[seat]++;
+		seats->_hard[seat]++;
+	} else {
+		seats->_hard[seat] += card_value(card);
+	}
+
+	// Use an ace as 11 if it doesn't bust them
+	seats->score[seat] = seats->_hard[seat];
+	if (player_is_soft(seats,seat)) {
+		seats->score[seat] += 10;
 	}
 
-	if (player->score>21) {
-		player->busted = TRUE;
+	seats->blackjack[seat] = (seats->_num_cards[seat]==2 && seats->score[seat]==21);
+	if (seats->score[seat]>21) {
+		seats->busted[seat] = TRUE;
 	}
 	return TRUE;
 }
@@ -241,15 +343,23 @@ bool player_hit(Player *player,Card *card) {
 /**
  * Returns the number of aces the player has
  */
-int player_count_aces(Player *player) {
-	int i;
-	int num_aces=0;
-	for (i=0;i<player->_num_cards;i++) {
-		if (card_is_ace(player->cards[i])) {
-			num_aces++;
-		}
-	}
-	return num_aces;
+int player_count_aces(Seats *seats,int seat) {
+	return seats->_num_aces[seat];
+}
+
+/**
+ * Returns TRUE if the player has an ace that is counted as 11
+ */
+bool player_is_soft(Seats *seats,int seat) {
+	return seats->_num_aces[seat]>0 && seats->_hard[seat]<=11;
+}
+
+/**
+ * returns TRUE if the player can still take a card, not once they have
+ * 21 (which also keeps the hand within SEATS_MAX_CARDS) or busted.
+ */
+bool player_can_hit(Seats *seats,int seat) {
+	return seats->score[seat]<21;
 }
 
 /**
@@ -259,14 +369,14 @@ int player_count_aces(Player *player) {
  * 	 - Bets are in multiples of $5
  * returns TRUE if the bet was valid and made.
  */
-bool player_bet(Player *player,double amount) {
-	if (amount<5 || fmod(amount,5.0)!=0.0) {
+bool player_bet(Seats *seats,int seat,Money amount) {
+	if (amount<MONEY_MIN_BET || amount%MONEY_MIN_BET!=0) {
 		printf("Minimum bet is $5 and must be in $5 increments!\n");
 		return FALSE;
 	}
-	if (player->money>=amount) { // if they have enough
-		player->bet = amount;
-		player->money -= amount;
+	if (seats->money[seat]>=amount) { // if they have enough
+		seats->bet[seat] = amount;
+		seats->money[seat] -= amount;
 		return TRUE;
 	}
 	printf("You don't have enough money to bet that much!\n");
@@ -276,265 +386,512 @@ bool player_bet(Player *player,double amount) {
 /**
  * Returns 1 if the player beat the dealer, 0 if tie, -1 if lost.
  */
-int player_cmp(Player *player,Player *dealer) {
-	if (player->busted) {
+int player_cmp(Seats *seats,int seat,int dealer) {
+	if (seats->busted[seat]) {
 		return -1;
-	} else if (dealer->busted || player->score>dealer->score) {
+	} else if (seats->busted[dealer] || seats->score[seat]>seats->score[dealer]) {
 		return 1; // player didn't bust and score is higher
-	} else if (player->score==dealer->score){
+	} else if (seats->score[seat]==seats->score[dealer]){
 		return 0; // tie
 	}
 	// lost
 	return -1;
 }
+
+/**
+ * Pays out the player's bet once the dealer is done.
+ * 	 - Winning pays 1:1, any 21 pays 3:2
+ * 	 - A tie gives the player their bet back
+ * 	 - Losing keeps the bet (taken out when it was made)
+ * returns the amount won, 0 if tied or minus the bet if lost.
+ * Bets are in multiples of $5 so 3:2 always comes out to the cent.
+ */
+Money player_settle(Seats *seats,int seat,int dealer) {
+	int j=player_cmp(seats,seat,dealer);
+	Money bet = seats->bet[seat];
+	if (j>0 || seats->score[seat]==21) { // won
+		Money won = bet;
+		if (seats->score[seat]==21) { // blackjack
+			won = bet*3/2;
+		}
+		seats->money[seat]+=bet+won;
+		return won;
+	} else if(j==0) { // tied, player get's money back
+		seats->money[seat]+=bet;
+		return 0;
+	}
+	// lost, bet already taken out when game started
+	return -bet;
+}
 // ========================================= PLAYER =================================================
 
 // ========================================= BLACKJACK =================================================
-#ifndef Blackjack
-/**
- * Representation of game state
- */
-typedef struct Blackjack {
-	Card *deck[52]; // Cards still left in the deck
-	int _num_cards; // Cards left in the deck
-	Player *players[7]; // I guess you could have more...
-	int _num_players; // Players
-	bool finished;
-} Blackjack;
-Blackjack *blackjack_create(int num_players);
-bool blackjack_init_round(Blackjack *game);
-bool blackjack_init_deck(Blackjack *game);
-bool blackjack_shuffle_deck(Blackjack *game);
-bool blackjack_deal_card(Blackjack *game, Player *player);
-#endif
-
 /**
  * Creates the blackjack and inits the players
- * and game.
+ * and game. The game gets a copy of rng so give each
+ * game a different stream (see rng_stream).
  */
-Blackjack *blackjack_create(int num_players) {
+Blackjack *blackjack_create(int num_players,int num_decks,double penetration,const Rng *rng) {
 	Blackjack *game = malloc(sizeof(Blackjack));
 	assert(game != NULL);
-	srand(time(NULL));
+	assert(num_players<=SEATS_MAX);
 	int i;
 
 	// Init vals
 	game->_num_players=0;
-	game->_num_cards=0;
 	game->finished=FALSE;
+	game->rng = *rng; // Each game has its own
+	game->shoe = shoe_create(num_decks,penetration,&game->rng);
 
 	// Init players
 	for (i=0;i<num_players;i++) {
-		game->players[i] = player_create(i);
+		player_create(&game->seats,i,i);
 		game->_num_players++;
 	}
 
 	return game;
 }
 
+/**
+ * Frees the game along with any players still in it
+ */
+bool blackjack_destroy(Blackjack *game) {
+	assert(game!=NULL);
+	assert(shoe_destroy(game->shoe));
+	free(game);
+	return TRUE;
+}
+
 /**
  * Restarts a game by:
  * 1. Collecting all the cards from the players
- * 2. Re-shuffling the deck
+ * 2. Re-shuffling the shoe if the cut card came out
  * 3. Dealing cards to all the players
  */
 bool blackjack_init_round(Blackjack *game) {
 	int i;
 	game->finished = FALSE;
 
-	// Create the deck
-	assert(blackjack_init_deck(game));
-
-	// Shuffle the deck
-	for (i=0;i<7;i++) {
-		assert(blackjack_shuffle_deck(game));
+	// Shuffle up once the cut card is reached
+	if (shoe_needs_shuffle(game->shoe)) {
+		assert(shoe_init(game->shoe));
+		assert(shoe_shuffle(game->shoe));
 	}
 
 	// Clear any cards the players have
 	for (i=0;i<game->_num_players;i++) {
-		assert(player_init_round(game->players[i]));
+		assert(player_init_round(&game->seats,i));
 	}
 
 	// Deal cards out to the players
 	for (i=0;i<(game->_num_players);i++) {
-		assert(blackjack_deal_card(game,game->players[i]));
-		assert(blackjack_deal_card(game,game->players[i]));
+		assert(blackjack_deal_card(game,i));
+		assert(blackjack_deal_card(game,i));
 	}
 
 	return TRUE;
 }
 
 /**
- * Create the deck
+ * Takes a card from the top of the shoe and gives it to the player.
  */
-bool blackjack_init_deck(Blackjack *game) {
-	char *c[11] = {"0","1","2","3","4","5","6","7","8","9","10"};
-	game->_num_cards=0;
-	int i,j;
-	//CardSuite suite = CLUBS;
-	for (j=0;j<4;j++) { // foreach suite
-		for (i=2;i<11;i++) { // 1-9
-			game->deck[game->_num_cards] = card_create(c[i],j,i,i);
-			game->_num_cards++;
-		}
+bool blackjack_deal_card(Blackjack *game,int seat) {
+	assert(player_hit(&game->seats,seat,shoe_draw(game->shoe)));
+	return TRUE;
+}
 
-		game->deck[game->_num_cards] = card_create("J",j,10,10);
-		game->_num_cards++;
-		game->deck[game->_num_cards] = card_create("Q",j,10,10);
-		game->_num_cards++;
-		game->deck[game->_num_cards] = card_create("K",j,10,10);
-		game->_num_cards++;
-		game->deck[game->_num_cards] = card_create("A",j,11,1);
-		game->_num_cards++;
+/**
+ * Remove a player from the game, the last player is moved into their
+ * seat. If iterating over players make sure to decrement your count
+ * after removing so the moved player isn't skipped!
+ */
+bool blackjack_remove_player(Blackjack *game,int seat) {
+	Seats *seats = &game->seats;
+	int last = game->_num_players-1;
+	if (seat<1 || seat>last) { // The dealer can't leave
+		return FALSE;
+	}
+	if (seat!=last) {
+		seats->id[seat] = seats->id[last];
+		seats->score[seat] = seats->score[last];
+		seats->_hard[seat] = seats->_hard[last];
+		seats->_num_aces[seat] = seats->_num_aces[last];
+		seats->_num_cards[seat] = seats->_num_cards[last];
+		seats->busted[seat] = seats->busted[last];
+		seats->blackjack[seat] = seats->blackjack[last];
+		seats->money[seat] = seats->money[last];
+		seats->bet[seat] = seats->bet[last];
+		memcpy(seats->cards[seat],seats->cards[last],seats->_num_cards[last]);
 	}
+	game->_num_players--;
 	return TRUE;
 }
 
 /**
- * Shuffle the cards by randomly sorting the indexes of the cards
- * based on: http://stackoverflow.com/questions/6127503/shuffle-array-in-c
+ * Finds the seat of the player with the given id, -1 if they left
  */
-bool blackjack_shuffle_deck(Blackjack *game) {
-	assert(game->_num_cards>0);
-	Card *tmp;
+int blackjack_find_player(Blackjack *game,int id) {
 	int i;
-	for (i=0;i<game->_num_cards-1;i++) {
-		// Pick a random index
-		int j = i + rand() / (RAND_MAX / (game->_num_cards - i) + 1);
-		// Swap the two cards
-		tmp = game->deck[j];
-		game->deck[j] = game->deck[i];
-		game->deck[i] = tmp;
+	for (i=0;i<game->_num_players;i++) {
+		if (game->seats.id[i]==id) {
+			return i;
+		}
 	}
-	return TRUE;
+	return -1;
 }
 
+// ========================================= BLACKJACK =================================================
+
+
+// ========================================= CLIENT =================================================
+// Keep messages a power of two and well under PIPE_BUF so writes are atomic
+_Static_assert(sizeof(Message)==64,"Message should be 64 bytes");
+
 /**
- * Takes a card from the top of the deck and gives it to the player.
+ * Clears the message and sets what it is and who it's for
  */
-bool blackjack_deal_card(Blackjack *game, Player *player) {
-	assert(game->_num_cards>0);
-	game->_num_cards--;
-	assert(player_hit(player,game->deck[game->_num_cards]));
-	game->deck[game->_num_cards] = NULL; // Remove this card from the deck
-	return TRUE;
+void message_init(Message *msg,MessageOp op,int seat) {
+	memset(msg,0,sizeof(Message));
+	msg->op = op;
+	msg->seat = seat;
 }
 
 /**
- * Remove a player from the game. If iterating over players
- * make sure to decrement your count after removing!
+ * Copies the player's and dealer's (seat 0) hands into the message
  */
-bool blackjack_remove_player(Blackjack *game,Player *player) {
-	int i=0;
-	bool found=FALSE;
-	if(game->_num_players<1) {
-		return FALSE;
+void message_set_cards(Message *msg,Seats *seats,int seat) {
+	msg->num_cards = seats->_num_cards[seat];
+	memcpy(msg->cards,seats->cards[seat],seats->_num_cards[seat]);
+	msg->num_dealer_cards = seats->_num_cards[0];
+	memcpy(msg->dealer_cards,seats->cards[0],seats->_num_cards[0]);
+}
+
+/**
+ * Deals the cards in the message back out so the dealer is at seat 0
+ * and the player (with the given id) at 1, scored the same way the
+ * dealer scores them.
+ */
+void message_get_seats(const Message *msg,Seats *seats,int id) {
+	int i;
+	player_create(seats,0,0);
+	player_create(seats,1,id);
+	for (i=0;i<msg->num_cards;i++) {
+		player_hit(seats,1,msg->cards[i]);
 	}
-	// Shift all the items in the array back one after found
-	for (i=0;i<game->_num_players;i++) {
-		if (game->players[i]==player) {
-			assert(player_destroy(player));
-			game->players[i] = NULL;
-			found = TRUE;
-		} else if (found) {
-			game->players[i-1] = game->players[i];
-		}
+	for (i=0;i<msg->num_dealer_cards;i++) {
+		player_hit(seats,0,msg->dealer_cards[i]);
 	}
-	if (found) {
-		game->_num_players--;
+}
+
+// Tell the cpu we're spinning
+#if defined(__x86_64__) || defined(__i386__)
+#define CLIENT_RELAX() __builtin_ia32_pause()
+#else
+#define CLIENT_RELAX() atomic_signal_fence(memory_order_seq_cst)
+#endif
+
+// Tries before parking, just the one with a single cpu since the writer
+// can't run while the reader spins. Set when the first ring is made.
+static int client_ring_spins = -1;
+
+// Clients whose dealer ends are open, forked children close them
+static Client *client_list = NULL;
+
+/**
+ * Adds a message to the ring and wakes the reader if it's asleep.
+ * returns FALSE if the ring is full, the reader is gone or stuck.
+ */
+static bool client_ring_push(ClientRing *ring,int fd,const Message *msg) {
+	unsigned int tail = atomic_load_explicit(&ring->tail,memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&ring->head,memory_order_acquire);
+	char bell = 0;
+	int state;
+	if (tail-head==CLIENT_RING_SIZE) {
+		return FALSE;
 	}
-	return found;
+	ring->msgs[tail & (CLIENT_RING_SIZE-1)] = *msg;
+	atomic_store_explicit(&ring->tail,tail+1,memory_order_release);
+
+	// Pairs with the fence in client_ring_pop so either the reader
+	// sees the message or we see it's parked
+	atomic_thread_fence(memory_order_seq_cst);
+	state = atomic_load_explicit(&ring->state,memory_order_relaxed);
+	if (state==RING_PARKED && atomic_compare_exchange_strong(&ring->state,&state,RING_AWAKE)) {
+		return r_write(fd,&bell,1)==1;
+	}
+	return TRUE;
 }
 
-// ========================================= BLACKJACK =================================================
+static bool client_ring_try_pop(ClientRing *ring,Message *msg) {
+	unsigned int head = atomic_load_explicit(&ring->head,memory_order_relaxed);
+	if (head==atomic_load_explicit(&ring->tail,memory_order_acquire)) {
+		return FALSE;
+	}
+	*msg = ring->msgs[head & (CLIENT_RING_SIZE-1)];
+	atomic_store_explicit(&ring->head,head+1,memory_order_release);
+	return TRUE;
+}
 
+/**
+ * Tells the writer to ring the bell for the next message. returns
+ * FALSE if one came in just now and the reader is still awake.
+ */
+static bool client_ring_park(ClientRing *ring) {
+	atomic_store_explicit(&ring->state,RING_PARKED,memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&ring->tail,memory_order_relaxed)!=atomic_load_explicit(&ring->head,memory_order_relaxed)) {
+		int state = RING_PARKED;
+		if (atomic_compare_exchange_strong(&ring->state,&state,RING_AWAKE)) {
+			return FALSE; // Woke ourselves, nobody will ring
+		}
+	}
+	return TRUE; // The writer is ringing (or will ring) the bell
+}
 
-// ========================================= CLIENT =================================================
-#ifndef Client
-/**
- * An interface to communicate via pipes
- */
-typedef struct Client {
-	int id;
-	pid_t pid;
-	int rfd[2]; // pipe fds for read
-	int wfd[2]; // pipe fds for write
-} Client;
-Client *client_create(int id);
-bool client_close(Client *client);
-int client_main();
-bool client_destroy(Client *client);
-void client_printf(Client *client,const char *fmt,...);
-int client_sendline(Client *client,const char *fmt,...);
-char *client_readline(Client *client);
-#endif
+/**
+ * Takes the next message off the ring, spinning for a bit and then
+ * sleeping on the pipe if there's none. returns FALSE if the writer
+ * is gone.
+ */
+static bool client_ring_pop(ClientRing *ring,int fd,Message *msg) {
+	char bell;
+	int i;
+	while (TRUE) {
+		for (i=0;i<client_ring_spins;i++) {
+			if (client_ring_try_pop(ring,msg)) {
+				return TRUE;
+			}
+			CLIENT_RELAX();
+		}
+		if (!client_ring_park(ring)) {
+			continue;
+		}
+		if (r_read(fd,&bell,1)!=1) {
+			return FALSE;
+		}
+	}
+}
 
-Client *client_create(int id) {
+Client *client_create(int id,ClientTransport transport,struct Strategy *strategy) {
 	Client *client = malloc(sizeof(Client));
 	assert(client != NULL);
 
 	client->id = id;
+	client->table = -1;
+	client->seq = 0;
+	client->owner = NULL;
+	client->ring = NULL;
+	client->strategy = strategy;
 
 	// Create the pipes
 	assert(pipe(client->rfd) !=-1); // for read
 	assert(pipe(client->wfd) !=-1); // for read
 
-	// Fork the process
+	// Map the rings before forking so both sides share them
+	if (transport==CLIENT_SHM) {
+		if (client_ring_spins<0) {
+			client_ring_spins = (sysconf(_SC_NPROCESSORS_ONLN)>1) ? CLIENT_RING_SPINS : 1;
+		}
+		client->ring = mmap(NULL,2*sizeof(ClientRing),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+		assert(client->ring != MAP_FAILED);
+		memset(client->ring,0,2*sizeof(ClientRing));
+	}
+
+	// Fork the process, flush first so the child doesn't print what's buffered again
+	fflush(stdout);
 	client->pid = fork();
 	assert(client->pid != -1);
 
 	// If child, do client_main()
 	if (client->pid==0) {
+		Client *other;
 		assert(r_close(client->rfd[0])!=-1); // client writes to rfd1, close 0
 		assert(r_close(client->wfd[1])!=-1); // client reads from wrf0, close 1;
 
+		// Drop the dealer's ends of the earlier players' pipes, otherwise
+		// they never see EOF when the dealer exits
+		for (other=client_list;other!=NULL;other=other->_next) {
+			assert(r_close(other->rfd[0])!=-1);
+			assert(r_close(other->wfd[1])!=-1);
+		}
+		client_list = NULL;
+
 		exit(client_main(client));
 	} else {
 		assert(r_close(client->rfd[1])!=-1); // parent reads from rfd0, close 1
 		assert(r_close(client->wfd[0])!=-1); // parent writes to wfd1, close 0
 	}
 
+	client->_prev = NULL;
+	client->_next = client_list;
+	if (client_list!=NULL) {
+		client_list->_prev = client;
+	}
+	client_list = client;
+
 	// Return object client to parent;
 	return client;
 }
 
 /**
- * Send a line to the child, if used in the child process
- * it sends a line to the parent.
+ * Looks up a transport by name. returns FALSE if there is none.
+ */
+bool client_find_transport(const char *name,ClientTransport *transport) {
+	if (strcmp(name,"pipe")==0) {
+		*transport = CLIENT_PIPE;
+	} else if (strcmp(name,"shm")==0) {
+		*transport = CLIENT_SHM;
+	} else {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Closes the dealer's ends of the pipes and frees the client.
+ * The process should have been told to EXIT first.
+ */
+bool client_destroy(Client *client) {
+	assert(client!=NULL);
+	assert(r_close(client->rfd[0])!=-1);
+	assert(r_close(client->wfd[1])!=-1);
+	if (client->_prev!=NULL) {
+		client->_prev->_next = client->_next;
+	} else {
+		client_list = client->_next;
+	}
+	if (client->_next!=NULL) {
+		client->_next->_prev = client->_prev;
+	}
+	if (client->ring!=NULL) {
+		assert(munmap(client->ring,2*sizeof(ClientRing))==0);
+	}
+	free(client);
+	return TRUE;
+}
+
+/**
+ * Send a message to the child, if used in the child process
+ * it sends it to the parent. Messages are smaller than PIPE_BUF
+ * so each one is a single write. With shared memory it goes in
+ * the ring instead and the pipe is only written to wake them up.
  */
-int client_sendline(Client *client,const char *fmt,...) {
+bool client_send(Client *client,const Message *msg) {
 	int fd = client->wfd[1]; // parent
 	if (client->pid==0) {
 		fd=client->rfd[1]; // child
 	}
-	char *msg;
-	va_list args;
-	va_start(args,fmt);
-	vasprintf(&msg,fmt,args);
-	int nbytes = r_write(fd,msg,(size_t)strlen(msg));
-	//client_printf(client,"Wrote '%s'\n",msg);
-	va_end(args);
-	free(msg);
-	return nbytes;
+	if (client->ring!=NULL) {
+		return client_ring_push(&client->ring[client->pid==0],fd,msg);
+	}
+	return r_write(fd,(void *)msg,sizeof(Message))==sizeof(Message);
 }
 
 /**
- * Read a line from the child, if used in the child process
- * it reads a line from the parent.
+ * Read a message from the child, if used in the child process
+ * it reads a message from the parent. Returns FALSE if the other
+ * side is gone.
  */
-char *client_readline(Client *client) {
+bool client_recv(Client *client,Message *msg) {
 	int fd = client->rfd[0]; // parent
 	if (client->pid==0) {
 		fd=client->wfd[0]; // child
 	}
-	size_t nbytes=256;
-	char *buf[nbytes];
-	int error = r_readline(fd,buf,nbytes);
-	if (error==-1) {
-		return NULL;
+	if (client->ring!=NULL) {
+		return client_ring_pop(&client->ring[client->pid!=0],fd,msg);
 	}
-	//client_printf(client,"Read '%s'\n",buf);
-	return buf;
+	return r_readblock(fd,msg,sizeof(Message))==sizeof(Message);
+}
+
+/**
+ * Sends a request to the child, stamped with a new sequence number
+ * so a late reply to an older request can be told apart.
+ */
+bool client_ask(Client *client,Message *msg) {
+	client->seq++;
+	msg->seq = client->seq;
+	if (client->ring!=NULL && client->pid!=0) {
+		// The reply is looked for, so the player needn't ring for it
+		atomic_store_explicit(&client->ring[1].state,RING_AWAKE,memory_order_relaxed);
+	}
+	return client_send(client,msg);
+}
+
+/**
+ * For a dealer that sleeps in epoll instead of client_recv(). Reads
+ * the byte the player rang its pipe with, FALSE if the player is gone.
+ */
+bool client_bell(Client *client) {
+	char bell;
+	return r_read(client->rfd[0],&bell,1)==1;
+}
+
+/**
+ * Takes a reply off the player's ring without waiting, FALSE if
+ * there's none yet.
+ */
+bool client_poll(Client *client,Message *msg) {
+	return client_ring_try_pop(&client->ring[1],msg);
+}
+
+/**
+ * Has the player ring for its next reply, once the dealer is done
+ * polling and about to sleep. returns FALSE if one just came in
+ * and it should be polled again instead.
+ */
+bool client_park(Client *client) {
+	return client_ring_park(&client->ring[1]);
+}
+
+/**
+ * Adds the client to the epoll set so it can be gathered from
+ */
+bool client_watch(int epfd,Client *client) {
+	struct epoll_event ev;
+	memset(&ev,0,sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = client;
+	return epoll_ctl(epfd,EPOLL_CTL_ADD,client->rfd[0],&ev)==0;
+}
+
+bool client_unwatch(int epfd,Client *client) {
+	return epoll_ctl(epfd,EPOLL_CTL_DEL,client->rfd[0],NULL)==0;
+}
+
+/**
+ * Reads a line the user typed
+ */
+static char *client_getline(char **line,size_t *n) {
+	if (getline(line,n,stdin)<0) {
+		return "";
+	}
+	return *line;
+}
+
+/**
+ * Answers for the player with their strategy instead of asking.
+ * returns FALSE if it's not something that gets answered.
+ */
+static bool client_play(Client *client,const Message *msg,Message *reply) {
+	Strategy *strategy = client->strategy;
+	Seats seats; // The dealer and them as far as they know
+	if (strategy->answer!=NULL) { // Wants the whole message
+		return strategy->answer(strategy,client,msg,reply);
+	}
+	message_get_seats(msg,&seats,client->id);
+	switch (msg->op) {
+		case MSG_AMT:
+			reply->amount = CLIENT_AUTO_MONEY;
+			return TRUE;
+		case MSG_BET:
+			seats.money[1] = CLIENT_AUTO_MONEY;
+			reply->amount = strategy->bet(strategy,&seats,1);
+			return TRUE;
+		case MSG_HIT:
+			reply->decision = strategy->hit(strategy,&seats,1);
+			return TRUE;
+	}
+	return FALSE;
 }
 
 /**
@@ -542,34 +899,75 @@ char *client_readline(Client *client) {
  */
 int client_main(Client *client) {
 	size_t buf = 256;
-	char *resp;
-	char *cmd = malloc(buf*sizeof(char));
-	client_printf(client,"Hello from the client!\n");
+	char *resp = malloc(buf*sizeof(char));
+	char card[CARD_STR_MAX];
+	Message msg;
+	Message reply;
+	int i;
+	if (client->strategy==NULL) {
+		client_printf(client,"Hello from the client!\n");
+	}
 	while(TRUE) {
-		client_printf(client,"Waiting for cmd...\n");
-		strcpy(cmd,client_readline(client));
-
-		// TODO: Handle the cmd;
-		if (strcmp(cmd,"AMT\n")==0) {
+		if (client->strategy==NULL) {
+			client_printf(client,"Waiting for cmd...\n");
+		}
+		if (!client_recv(client,&msg)) { // dealer is gone
+			break;
+		}
+		message_init(&reply,MSG_REPLY,client->id);
+		reply.seq = msg.seq;
+
+		if (msg.op==MSG_ATTACH) { // took a seat, the id is now theirs
+			client->id = msg.seat;
+			client->table = (int)msg.amount;
+			if (client->strategy!=NULL) {
+				strategy_attach(client->strategy,client);
+			}
+			if (client->strategy==NULL) {
+				client_printf(client,"Sat down.\n");
+			}
+			continue;
+		} else if (msg.op==MSG_DETACH) {
+			if (client->strategy==NULL) {
+				client_printf(client,"Left the table.\n");
+			}
+			continue;
+		} else if (client->strategy!=NULL) { // Plays itself
+			if (!client_play(client,&msg,&reply)) {
+				break;
+			}
+		} else if (msg.op==MSG_AMT) {
 			client_printf(client,"How much money are you playing with?\n");
-			getline(&resp, &buf, stdin);
-			client_sendline(client,"%s",resp);
-		} else if (strcmp(cmd,"BET\n")==0)  {
+			reply.amount = money_parse(client_getline(&resp,&buf));
+		} else if (msg.op==MSG_BET)  {
 			client_printf(client,"What is your bet?\n");
-			getline(&resp, &buf, stdin);
-			client_sendline(client,"%s",resp);
-		} else if (strcmp(cmd,"HIT\n")==0) {
+			reply.amount = money_parse(client_getline(&resp,&buf));
+		} else if (msg.op==MSG_HIT) {
+			client_printf(client,"You have");
+			for (i=0;i<msg.num_cards;i++) {
+				card_format(msg.cards[i],card,sizeof(card));
+				printf(" %s",card);
+			}
+			printf(", the dealer has");
+			for (i=0;i<msg.num_dealer_cards;i++) {
+				card_format(msg.dealer_cards[i],card,sizeof(card));
+				printf(" %s",card);
+			}
+			printf("\n");
 			client_printf(client,"Would you like to hit (Y/N)?\n");
-			getline(&resp, &buf, stdin);
-			client_sendline(client,"%s",resp);
-		} else if (strstr(cmd, "CARDS") != NULL){
-			client_printf(client,"%s\n",cmd);
-			client_sendline(client,"Ok\n");
+			client_getline(&resp,&buf);
+			reply.decision = (resp[0]=='Y' || resp[0]=='y');
 		} else {
 			break;
 		}
+		if (!client_send(client,&reply)) {
+			break;
+		}
 	};
-	client_printf(client,"Goodbye!\n");
+	free(resp);
+	if (client->strategy==NULL) {
+		client_printf(client,"Goodbye!\n");
+	}
 	return EXIT_SUCCESS;
 }
 
@@ -588,26 +986,317 @@ void client_printf(Client *client,const char *fmt,...) {
 
 // ========================================= CLIENT =================================================
 
+// ========================================= CLIENT POOL =================================================
+
+ClientPool *client_pool_create(int num_clients,ClientTransport transport,struct Strategy *strategy) {
+	ClientPool *pool = malloc(sizeof(ClientPool));
+	assert(pool != NULL);
+	pool->_size = 16;
+	pool->idle = malloc(pool->_size*sizeof(Client *));
+	assert(pool->idle != NULL);
+	pool->_num_idle = 0;
+	pool->transport = transport;
+	pool->strategy = strategy;
+	assert(client_pool_grow(pool,num_clients));
+	return pool;
+}
+
+/**
+ * Tells the idle processes to exit and frees them
+ */
+bool client_pool_destroy(ClientPool *pool) {
+	Message msg;
+	assert(pool!=NULL);
+	while (pool->_num_idle>0) {
+		Client *client = pool->idle[--pool->_num_idle];
+		message_init(&msg,MSG_EXIT,client->id);
+		client_send(client,&msg);
+		assert(client_destroy(client));
+	}
+	free(pool->idle);
+	free(pool);
+	return TRUE;
+}
+
+static void client_pool_put(ClientPool *pool,Client *client) {
+	if (pool->_num_idle==pool->_size) {
+		pool->_size *= 2;
+		pool->idle = realloc(pool->idle,pool->_size*sizeof(Client *));
+		assert(pool->idle != NULL);
+	}
+	pool->idle[pool->_num_idle++] = client;
+}
+
+/**
+ * Forks num_clients more idle processes
+ */
+bool client_pool_grow(ClientPool *pool,int num_clients) {
+	int i;
+	for (i=0;i<num_clients;i++) {
+		client_pool_put(pool,client_create(0,pool->transport,pool->strategy));
+	}
+	return TRUE;
+}
+
+/**
+ * Gives seat id an idle process, a new one is only forked if
+ * the pool has run out. NULL if it can't be given one.
+ */
+Client *client_pool_attach(ClientPool *pool,int table,int id) {
+	Client *client;
+	Message msg;
+	message_init(&msg,MSG_ATTACH,id);
+	msg.amount = table;
+	while (pool->_num_idle>0) {
+		client = pool->idle[--pool->_num_idle];
+		client->id = id;
+		if (client_send(client,&msg)) {
+			return client;
+		}
+		assert(client_destroy(client)); // It died while waiting
+	}
+	client = client_create(id,pool->transport,pool->strategy);
+	if (!client_send(client,&msg)) {
+		assert(client_destroy(client));
+		return NULL;
+	}
+	return client;
+}
+
+/**
+ * Takes the process off its seat and puts it back in the pool.
+ * returns FALSE if its process is gone, it's up to the caller
+ * to client_destroy() it then.
+ */
+bool client_pool_detach(ClientPool *pool,Client *client) {
+	Message msg;
+	message_init(&msg,MSG_DETACH,client->id);
+	client->owner = NULL;
+	if (!client_send(client,&msg)) {
+		return FALSE;
+	}
+	client_pool_put(pool,client);
+	return TRUE;
+}
+
+// ========================================= CLIENT POOL =================================================
 
+// The Benchmark configuration has its own main (see bench.c)
+#ifndef BLACKJACK_BENCHMARK
+
+#define USAGE "Usage: blackjack [--simulate <rounds>] [--strategy <name>] [--threads <n>] [--decks <1-8>] [--penetration <0-1>] [--seed <n>] [--rng <xoshiro|pcg>] [--timeout <seconds>] [--tables <n>] [--transport <pipe|shm>] [--history <file>] [--metrics <socket>] [--replay <file>] [--bet <amount>] [--think <ms>] [--rounds <n>] [--quiet] [--analyze] [--advise] <number_of_players>\n"
 
 int main(int argc, char *argv[]) {
-	Player *dealer;Player *player;
-	Blackjack *game;
-	Client *clients[6];
+	TableManager *manager = NULL;
+	double timeout = 60;
 	int num_players;
+	int num_tables = 1;
+	bool analyze = FALSE;
+	bool advise = FALSE;
+	bool quiet = FALSE;
+	char *history = NULL;
+	char *metrics = NULL;
+	Replay *replay = NULL;
+	Bot *bot = NULL;
+	Money bet = 0;
+	double think = 0;
+	long rounds = 0;
+	double started;
+	double seconds;
+	ClientTransport transport = CLIENT_PIPE;
 	int i;
-	size_t buf=256;
-	char *cmd = malloc(buf*sizeof(char));
+	long simulate = 0;
+	char *strategy = NULL;
+	Strategy *auto_strategy = NULL;
+	ClientPool *pool;
+	int num_decks = 6;
+	double penetration = 0.75;
+	uint64_t seed = rng_make_seed();
+	RngType rng_type = RNG_XOSHIRO;
+	Rng rng;
+	int num_threads = 0;
+	int opt;
+	struct option options[] = {
+		{"simulate",required_argument,NULL,'n'},
+		{"strategy",required_argument,NULL,'s'},
+		{"decks",required_argument,NULL,'d'},
+		{"penetration",required_argument,NULL,'p'},
+		{"seed",required_argument,NULL,'r'},
+		{"rng",required_argument,NULL,'g'},
+		{"threads",required_argument,NULL,'t'},
+		{"timeout",required_argument,NULL,'w'},
+		{"tables",required_argument,NULL,'b'},
+		{"transport",required_argument,NULL,'x'},
+		{"history",required_argument,NULL,'h'},
+		{"quiet",no_argument,NULL,'q'},
+		{"metrics",required_argument,NULL,'m'},
+		{"replay",required_argument,NULL,'y'},
+		{"bet",required_argument,NULL,'e'},
+		{"think",required_argument,NULL,'k'},
+		{"rounds",required_argument,NULL,'o'},
+		{"analyze",no_argument,NULL,'a'},
+		{"advise",no_argument,NULL,'v'},
+		{NULL,0,NULL,0}
+	};
 
-	if (argc!=2) {
-		printf("Usage: blackjack <number_of_players>");
+	while ((opt=getopt_long(argc,argv,"",options,NULL))!=-1) {
+		switch (opt) {
+			case 'n':
+				simulate = atol(optarg);
+				break;
+			case 's':
+				strategy = optarg;
+				break;
+			case 'd':
+				num_decks = atoi(optarg);
+				break;
+			case 'p':
+				penetration = atof(optarg);
+				break;
+			case 'r':
+				seed = strtoull(optarg,NULL,0);
+				break;
+			case 't':
+				num_threads = atoi(optarg);
+				break;
+			case 'w':
+				timeout = atof(optarg);
+				break;
+			case 'b':
+				num_tables = atoi(optarg);
+				break;
+			case 'a':
+				analyze = TRUE;
+				break;
+			case 'v':
+				advise = TRUE;
+				break;
+			case 'h':
+				history = optarg;
+				break;
+			case 'q':
+				quiet = TRUE;
+				break;
+			case 'm':
+				metrics = optarg;
+				break;
+			case 'y':
+				replay = replay_load(optarg);
+				if (replay==NULL) {
+					printf(USAGE);
+					printf("Error: No session to replay in '%s'\n",optarg);
+					exit(1);
+				}
+				break;
+			case 'e':
+				bet = money_parse(optarg);
+				if (bet<MONEY_MIN_BET || bet%MONEY_MIN_BET!=0) {
+					printf(USAGE);
+					printf("Error: Bets must be in $" MONEY_FMT " increments, given '%s'\n",MONEY_ARGS(MONEY_MIN_BET),optarg);
+					exit(1);
+				}
+				break;
+			case 'k':
+				think = atof(optarg)/1000;
+				if (think<0) {
+					printf(USAGE);
+					printf("Error: The think time can't be negative, given '%s'\n",optarg);
+					exit(1);
+				}
+				break;
+			case 'o':
+				rounds = atol(optarg);
+				if (rounds<0) {
+					printf(USAGE);
+					printf("Error: The rounds can't be negative, given '%s'\n",optarg);
+					exit(1);
+				}
+				break;
+			case 'x':
+				if (!client_find_transport(optarg,&transport)) {
+					printf(USAGE);
+					printf("Error: Unknown transport '%s', use pipe or shm\n",optarg);
+					exit(1);
+				}
+				break;
+			case 'g':
+				if (!rng_find_type(optarg,&rng_type)) {
+					printf(USAGE);
+					printf("Error: Unknown rng '%s', use xoshiro or pcg\n",optarg);
+					exit(1);
+				}
+				break;
+			default:
+				printf(USAGE);
+				exit(1);
+		}
+	}
+	// Everything is played the same as the recording
+	if (replay!=NULL) {
+		num_tables = replay->num_tables;
+		num_decks = replay->num_decks;
+		penetration = replay->penetration;
+		rng_type = replay->rng_type;
+		seed = replay->seed;
+	}
+	if(num_decks<1 || num_decks>SHOE_MAX_DECKS || penetration<=0 || penetration>1) {
+		printf(USAGE);
+		printf("Error: Can only play with 1-%i decks and a penetration of (0-1]\n",SHOE_MAX_DECKS);
 		exit(1);
 	}
-	num_players = atoi(argv[1]);
-	if(!(1<num_players || num_players<7)) {
-		printf("Usage: blackjack <number_of_players>");
-		printf("Error: Can only play with 1-6 players, given %i",num_players);
+
+	// Exact odds from a full shoe, no game is played
+	if (analyze) {
+		return analyzer_main(num_decks);
+	}
+
+	if (replay!=NULL && optind==argc) {
+		num_players = replay->num_players;
+	} else if (optind!=argc-1) {
+		printf(USAGE);
 		exit(1);
+	} else {
+		num_players = atoi(argv[optind]);
+	}
+	if(num_players<1 || num_players>6) {
+		printf(USAGE);
+		printf("Error: Can only play with 1-6 players, given %i\n",num_players);
+		exit(1);
+	}
+	if(num_tables<1) {
+		printf(USAGE);
+		printf("Error: Need at least 1 table, given %i\n",num_tables);
+		exit(1);
+	}
+
+	assert(rng_init(&rng,rng_type,seed));
+	strategy_init(&rng);
+	printf("Seed: %" PRIu64 "\n",seed);
+
+	// Play the rounds headless, no player processes are needed
+	if (simulate>0) {
+		return sim_main(num_players,simulate,strategy==NULL ? "dealer" : strategy,num_decks,penetration,&rng,num_threads);
+	}
+
+	// The players play themselves instead of asking on stdin
+	if (replay!=NULL) {
+		auto_strategy = &replay->strategy;
+	} else if (strategy!=NULL) {
+		auto_strategy = strategy_find(strategy);
+		if (auto_strategy==NULL) {
+			printf(USAGE);
+			printf("Error: Unknown strategy '%s'\n",strategy);
+			exit(1);
+		}
+	}
+
+	// Bots for a load run, they play basic unless told otherwise
+	if (replay==NULL && (bet>0 || think>0 || rounds>0)) {
+		if (auto_strategy==NULL) {
+			auto_strategy = strategy_find("basic");
+		}
+		bot = bot_create(auto_strategy,bet,think,rounds);
+		auto_strategy = &bot->strategy;
 	}
 
 	/**
@@ -619,7 +1308,7 @@ int main(int argc, char *argv[]) {
 	 */
 	void handle_signals(int signo) {
 		printf("Caught SIGINT or SIGTSTP!\n");
-		if (game->_num_players<2) {
+		if (manager==NULL || table_manager_num_players(manager)<1) {
 			exit(0);
 		}
 	}
@@ -631,146 +1320,54 @@ int main(int argc, char *argv[]) {
 		perror("Failed to set SIGINT to handle Ctrl-C");
 	}
 
-	printf("\nWelcome to blackjack:\n");
-	printf("-----------------------------------\n");
-
-	// TODO: Create a client process for each player here
-	// For now do everything in one until it's working
-	for(i=1;i<num_players+1;i++) { // so index is same as player
-		clients[i] = client_create(i);
-	}
-
-	// Init the the game
-	num_players++; // +1 for dealer
-	game = blackjack_create(num_players);
-	dealer = game->players[0];
-
-
-	// When a player enters the game, they will tell the dealer the
-	// amount of money they will use to begin the game.
-	for (i=1;i<(game->_num_players);i++) {
-		player = game->players[i];
-
-		// TODO: Ask how much they're playing with
-		// TODO: Ask each player to bet and handle responses/
-		//printf("Player %i, how much money are you playing with?\n",player->id);
-		//getline(&cmd, &buf, stdin);
-		client_sendline(clients[i],"AMT\n");
-		strcpy(cmd,client_readline(clients[i]));
-		double money = strtod(cmd,NULL);
-
-		player->money = money;
-		printf("Player %i playing with $%0.2f\n",player->id,player->money);
-	}
-
-	// main loop
-	while(game->_num_players>1) {
-		printf("\nStarting new round:\n");
-		printf("-----------------------------------\n");
-
-		// Start the game
-		assert(blackjack_init_round(game));
-
-		printf("\nBets in:\n");
-		printf("-----------------------------------\n");
-		for (i=1;i<(game->_num_players);i++) {
-			player = game->players[i];
-
-			// Ask each player to bet and handle responses
-			//printf("Player %i, what is your bet?\n",player->id);
-			//getline(&cmd, &buf, stdin);
-			client_sendline(clients[i],"BET\n");
-			strcpy(cmd,client_readline(clients[i]));
-			double bet = strtod(cmd,NULL);
-
-			if (bet>0 && player_bet(player,bet)) {
-				printf("Player %i bet $%0.2f.\n",player->id,player->bet);
-			} else {
-				printf("Player %i left the table with $%0.2f.\n",player->id,player->money);
-				assert(blackjack_remove_player(game,player));
-				i--;
-			}
-		}
-
-		// Nobody is playing
-		if (game->_num_players<2) {
-			break;
-		}
+	// A player that quit shows up as a failed write instead of killing the dealer
+	signal(SIGPIPE,SIG_IGN);
 
-		// Ask each player to hit or stay and handle responses
-		for (i=1;i<(game->_num_players);i++) {
-			player = game->players[i];
-			printf("\nPlayer %i's turn:\n",player->id);
-			printf("-----------------------------------\n");
-			printf("Player %i has cards %s.\n",player->id,player_cards_to_str(player));
-
-			while (!(player->busted)) {
-				//printf("Player %i, would you like to hit?\n",player->id);
-				//getline(&cmd, &buf, stdin);
-				client_sendline(clients[i],"HIT\n");
-				strcpy(cmd,client_readline(clients[i]));
-				if (!(strcmp(cmd,"Y\n")==0||strcmp(cmd,"y\n")==0)){break;}
-				assert(blackjack_deal_card(game,player));
-				printf("Player %i hit and got [%s] giving score of %i.\n",player->id,card_to_str(player->cards[player->_num_cards-1]),player->score);
-			}
-			if (player->busted) {
-				printf("Player %i busted.\n",player->id);
-			} else {
-				printf("Player %i stayed with score %i.\n",player->id,player->score);
-			}
-			//printf("%s\n\n",player_to_str(player));
-		}
-		//     while player_hit
-
-		// DONE: Dealer choose to hit or stay
-		// Dealer:
-		//  - Always stays on 17 or higher
-		//  - Always hits on 16 or lower
-		printf("\nDealers turn:\n");
-		printf("-----------------------------------\n");
-		printf("Dealer has cards %s\n",player_cards_to_str(dealer));
-		while (!(dealer->busted) && (dealer->score<17)) {
-			assert(blackjack_deal_card(game,dealer));
-			printf("Dealer hit and got [%s] giving score of %i\n",card_to_str(dealer->cards[dealer->_num_cards-1]),dealer->score);
-		}
-		if (dealer->busted) {
-			printf("Dealer busted\n");
-		} else {
-			printf("Dealer stayed with score %i\n",dealer->score);
-		}
+	// kill -USR1 prints how long each phase of a round is taking
+	act.sa_handler = latency_on_signal;
+	if (sigaction(SIGUSR1, &act, NULL) == -1) {
+		perror("Failed to set SIGUSR1 to dump latencies");
+	}
 
-		// DONE: Round is over print out the hands
-		// Determine who won/lost and send that to the clients
-		printf("\n\nRound results:\n");
-		printf("-----------------------------------\n");
-		for (i=1;i<(game->_num_players);i++) {
-			player = game->players[i];
-			int j=player_cmp(player,dealer);
-			if (j>0 || player->score==21) { // won
-				double won = player->bet;
-				if (player->score==21) { // blackjack
-					won = player->bet*1.5;
-				}
-				player->money+=player->bet+won;
-				printf("Player %i won $%0.2f and has $%0.2f!\n",player->id,won,player->money);
-			} else if(j==0) { // tied, player get's money back
-				player->money+=player->bet;
-				printf("Player %i tied dealer and has $%0.2f!\n",player->id,player->money);
-			} else { // lost, bet already taken out when game started
-				printf("Player %i lost $%0.2f and has $%0.2f!\n",player->id,player->bet,player->money);
-			}
-		}
+	printf("\nWelcome to blackjack:\n");
+	printf("-----------------------------------\n");
 
-		// Remove anyone that's broke
-		for (i=1;i<(game->_num_players);i++) {
-			player = game->players[i];
-			if (player->money<5) {
-				client_sendline(clients[i],"EXIT\n");
-				printf("Player %i left the table.\n",player->id);
-				assert(blackjack_remove_player(game,player));
-				i--;
-			}
-		}
+	// Fork a client process for every seat up front, tables take them
+	// from the pool and all of them are run from the same epoll loop.
+	pool = client_pool_create(num_tables*num_players,transport,auto_strategy);
+	manager = table_manager_create(timeout,pool,num_decks,penetration,&rng);
+	manager->advise = advise;
+	if (history!=NULL && (manager->history=history_create(history))==NULL) {
+		perror("Failed to open the hand history");
+	} else if (history!=NULL) { // So it can be replayed
+		history_add(manager->history,HIST_SESSION,num_tables,num_players,rng_type,(int64_t)seed);
+		history_add(manager->history,HIST_SHOE,0,0,num_decks,(int64_t)(penetration*1e6+0.5));
+	}
+	if (metrics!=NULL && !table_manager_export(manager,metrics)) {
+		perror("Failed to export metrics");
+	}
+	for (i=0;i<num_tables;i++) {
+		assert(table_manager_add(manager,num_players,num_tables==1 && !quiet) != NULL);
+	}
+	started = latency_now()/1e9;
+	assert(table_manager_run(manager));
+	seconds = latency_now()/1e9-started;
+	if (replay!=NULL) {
+		printf("Replayed %li of %li rounds in %0.3f seconds (%0.0f rounds/sec).\n",manager->rounds,replay->rounds,seconds,manager->rounds/seconds);
+	} else if (bot!=NULL) { // How much the dealer can take
+		long hands = (long)metrics_get(&manager->metrics->page->hands);
+		printf("Played %li rounds (%li hands) at %i tables in %0.3f seconds, %0.0f rounds/sec and %0.0f hands/sec.\n",
+				manager->rounds,hands,num_tables,seconds,manager->rounds/seconds,hands/seconds);
+		latency_dump(manager->latency,stdout);
+	} else if (num_tables>1) {
+		printf("Played %li rounds at %i tables.\n",manager->rounds,num_tables);
+	}
+	assert(table_manager_destroy(manager));
+	if (replay!=NULL) {
+		assert(replay_destroy(replay));
+	}
+	if (bot!=NULL) {
+		assert(bot_destroy(bot));
 	}
 
 	// Wait for all to close
@@ -779,3 +1376,5 @@ int main(int argc, char *argv[]) {
 	printf("\nThanks for playing! HAVE A NICE DAY!\n");
 	return EXIT_SUCCESS;
 }
+
+#endif /* BLACKJACK_BENCHMARK */
@@ -0,0 +1,288 @@
+/*
+ * blackjack.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Game types shared between the dealer, the player processes and the
+ *  headless simulator.
+ */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include "restart.h"
+#include "helpers.h"
+#include "rng.h"
+
+#ifndef BLACKJACK_H_
+#define BLACKJACK_H_
+
+// Dealer always stays on this score or higher
+#ifndef DEALER_STANDS
+#define DEALER_STANDS 17
+#endif
+
+// ========================================= CARD =================================================
+
+// I guess this is irrelevant to blackjack but whatever
+#ifndef Suite
+typedef enum { CLUBS,DIAMONDS,HEARTS,SPADES } Suite;
+#endif
+
+#ifndef Card
+/**
+ * Representation of a card, packed into a single byte with the
+ * rank (1=A,2-10,11=J,12=Q,13=K) in the low nibble and the suite above it.
+ */
+typedef unsigned char Card;
+#define CARD_ACE 1
+#define CARD_KING 13
+#define CARD_RANK(card) ((card)&0x0F)
+#define CARD_SUITE(card) ((Suite)((card)>>4))
+#define CARD_STR_MAX 4 // Longest card string ("10H") with the terminator
+Card card_create(int rank,Suite suite);
+bool card_is_ace(Card card);
+int card_value(Card card);
+int card_format(Card card,char *buf,size_t size);
+#endif
+
+// ========================================= SHOE =================================================
+
+#ifndef SHOE_MAX_DECKS
+#define SHOE_MAX_DECKS 8
+#endif
+
+#ifndef Shoe
+/**
+ * One or more decks dealt from until the cut card comes out
+ */
+typedef struct Shoe {
+	Card *cards; // Cards still left in the shoe, dealt from the end
+	int _num_cards; // Cards left in the shoe
+	int _size; // Cards in a full shoe
+	int num_decks;
+	int cut; // Cards left when the cut card comes out
+	Rng *rng; // Used to shuffle
+	long shuffles; // Times it's been shuffled
+} Shoe;
+Shoe *shoe_create(int num_decks,double penetration,Rng *rng);
+bool shoe_destroy(Shoe *shoe);
+bool shoe_init(Shoe *shoe);
+bool shoe_shuffle(Shoe *shoe);
+bool shoe_needs_shuffle(Shoe *shoe);
+Card shoe_draw(Shoe *shoe);
+#endif
+
+// ========================================= MONEY =================================================
+
+#ifndef Money
+/**
+ * Amounts of money in cents so adding up and paying out is exact
+ */
+typedef int64_t Money;
+#define MONEY(dollars) ((Money)(dollars)*100)
+#define MONEY_MIN_BET MONEY(5) // Bets are also in multiples of this
+#define MONEY_MAX MONEY(1000000000000LL) // Most anyone can sit down with, far from overflowing
+Money money_parse(const char *str);
+#endif
+
+// Print money with "$" MONEY_FMT and MONEY_ARGS(amount) as the arguments
+#define MONEY_FMT "%s%" PRId64 ".%02" PRId64
+#define MONEY_ARGS(m) ((m)<0 ? "-" : ""),(((m)<0 ? -(m) : (m))/100),(((m)<0 ? -(m) : (m))%100)
+
+// ========================================= PLAYER =================================================
+
+// Dealer (seat 0) and up to 6 players
+#ifndef SEATS_MAX
+#define SEATS_MAX 7
+#endif
+
+// Could have up to 21 cards
+#ifndef SEATS_MAX_CARDS
+#define SEATS_MAX_CARDS 21
+#endif
+
+#ifndef Seats
+/**
+ * Everyone sitting at a table, one array per field indexed by seat so
+ * going around the table stays in one block of memory. Seat 0 is the
+ * dealer and the players follow it.
+ */
+typedef struct Seats {
+	int id[SEATS_MAX]; // Player id, stays the same if they change seats
+	int score[SEATS_MAX];
+	int _hard[SEATS_MAX]; // Score counting all aces as 1
+	int _num_aces[SEATS_MAX]; // Aces in the hand
+	int _num_cards[SEATS_MAX];
+	bool busted[SEATS_MAX];
+	bool blackjack[SEATS_MAX]; // 21 on the first two cards
+	Money money[SEATS_MAX];
+	Money bet[SEATS_MAX];
+	Card cards[SEATS_MAX][SEATS_MAX_CARDS]; // Cards the player has
+} Seats;
+// Room needed for player_cards_format with every card out ("[" + "10H," per card + "]")
+#define SEATS_CARDS_STR_MAX (SEATS_MAX_CARDS*CARD_STR_MAX+2)
+void player_create(Seats *seats,int seat,int id);
+bool player_init_round(Seats *seats,int seat);
+int player_cards_format(Seats *seats,int seat,char *buf,size_t size);
+int player_format(Seats *seats,int seat,char *buf,size_t size);
+bool player_hit(Seats *seats,int seat,Card card);
+int player_count_aces(Seats *seats,int seat);
+bool player_is_soft(Seats *seats,int seat);
+bool player_can_hit(Seats *seats,int seat);
+bool player_bet(Seats *seats,int seat,Money amount);
+int player_cmp(Seats *seats,int seat,int dealer);
+Money player_settle(Seats *seats,int seat,int dealer);
+#endif
+
+// ========================================= BLACKJACK =================================================
+
+#ifndef Blackjack
+/**
+ * Representation of game state
+ */
+typedef struct Blackjack {
+	Shoe *shoe; // Cards still left to deal
+	Rng rng;
+	Seats seats; // I guess you could have more...
+	int _num_players; // Players, seats 0 to _num_players-1 are taken
+	bool finished;
+} Blackjack;
+Blackjack *blackjack_create(int num_players,int num_decks,double penetration,const Rng *rng);
+bool blackjack_destroy(Blackjack *game);
+bool blackjack_init_round(Blackjack *game);
+bool blackjack_deal_card(Blackjack *game,int seat);
+bool blackjack_remove_player(Blackjack *game,int seat);
+int blackjack_find_player(Blackjack *game,int id);
+#endif
+
+// ========================================= CLIENT =================================================
+
+// Most events handled per epoll_wait
+#ifndef CLIENT_MAX_EVENTS
+#define CLIENT_MAX_EVENTS 16
+#endif
+
+#ifndef MessageOp
+typedef enum { MSG_AMT=1,MSG_BET,MSG_HIT,MSG_REPLY,MSG_EXIT,MSG_ATTACH,MSG_DETACH } MessageOp;
+#endif
+
+#ifndef Message
+/**
+ * Fixed size message sent between the dealer and a player process.
+ * The dealer sends AMT, BET, HIT or EXIT and the player answers AMT, BET
+ * and HIT with a REPLY holding the amount or decision. ATTACH and DETACH
+ * move a pooled player process to and from a seat, they get no reply.
+ */
+typedef struct Message {
+	unsigned char op; // MessageOp
+	unsigned char seat; // Player id
+	unsigned char decision; // Reply to HIT, TRUE to hit
+	unsigned char num_cards;
+	unsigned char num_dealer_cards;
+	unsigned char _pad;
+	unsigned short seq; // Replies have the seq of the request
+	Money amount; // Reply to AMT or BET, the table id with ATTACH
+	Card cards[21]; // Player's cards, sent with HIT
+	Card dealer_cards[21]; // Dealer's cards, sent with HIT
+	unsigned char _pad2[6];
+} Message;
+void message_init(Message *msg,MessageOp op,int seat);
+void message_set_cards(Message *msg,Seats *seats,int seat);
+void message_get_seats(const Message *msg,Seats *seats,int id);
+#endif
+
+// Messages each shared memory ring holds, must be a power of two
+#ifndef CLIENT_RING_SIZE
+#define CLIENT_RING_SIZE 16
+#endif
+
+// Times a player checks its ring before going to sleep on its pipe
+#ifndef CLIENT_RING_SPINS
+#define CLIENT_RING_SPINS 4096
+#endif
+
+struct Strategy;
+
+// Money an automated player sits down with
+#ifndef CLIENT_AUTO_MONEY
+#define CLIENT_AUTO_MONEY MONEY(1000)
+#endif
+
+#ifndef ClientTransport
+typedef enum { CLIENT_PIPE,CLIENT_SHM } ClientTransport;
+#endif
+
+#ifndef ClientRing
+typedef enum { RING_AWAKE,RING_PARKED } RingState;
+
+/**
+ * Single producer, single consumer queue of messages in memory shared
+ * by the dealer and a player. The counters only ever go up and are
+ * on their own cache lines so the two sides don't fight over them.
+ * The reader sleeps on its pipe (the dealer in epoll) when the ring is
+ * empty and the writer only writes a byte to wake it if it's asleep.
+ */
+typedef struct ClientRing {
+	_Atomic unsigned int head __attribute__((aligned(64))); // Next to read, only the reader moves it
+	_Atomic unsigned int tail __attribute__((aligned(64))); // Next to write, only the writer moves it
+	_Atomic int state __attribute__((aligned(64))); // RingState of the reader
+	Message msgs[CLIENT_RING_SIZE] __attribute__((aligned(64)));
+} ClientRing;
+#endif
+
+#ifndef Client
+/**
+ * An interface to communicate via pipes, or shared memory
+ * rings with the pipes used to wake up the other side.
+ */
+typedef struct Client {
+	int id;
+	int table; // Table the player sits at, set by ATTACH
+	pid_t pid;
+	int rfd[2]; // pipe fds for read
+	int wfd[2]; // pipe fds for write
+	ClientRing *ring; // [0] to the player, [1] to the dealer, NULL when using the pipes
+	struct Strategy *strategy; // Plays for the player, NULL to ask on stdin
+	unsigned short seq; // Last request sent
+	void *owner; // Whatever handles its replies, eg the Table it sits at
+	struct Client *_prev,*_next; // Every client the dealer has open
+} Client;
+Client *client_create(int id,ClientTransport transport,struct Strategy *strategy);
+bool client_find_transport(const char *name,ClientTransport *transport);
+bool client_close(Client *client);
+int client_main();
+bool client_destroy(Client *client);
+void client_printf(Client *client,const char *fmt,...);
+bool client_send(Client *client,const Message *msg);
+bool client_recv(Client *client,Message *msg);
+bool client_ask(Client *client,Message *msg);
+bool client_bell(Client *client);
+bool client_poll(Client *client,Message *msg);
+bool client_park(Client *client);
+bool client_watch(int epfd,Client *client);
+bool client_unwatch(int epfd,Client *client);
+#endif
+
+#ifndef ClientPool
+/**
+ * Player processes forked ahead of time. Seats are given one when a
+ * player sits down and it goes back to the pool when they leave,
+ * idle ones wait on their pipe for the next seat.
+ */
+typedef struct ClientPool {
+	Client **idle;
+	int _num_idle;
+	int _size; // Room in idle
+	ClientTransport transport;
+	struct Strategy *strategy; // Plays for the players, NULL to ask on stdin
+} ClientPool;
+ClientPool *client_pool_create(int num_clients,ClientTransport transport,struct Strategy *strategy);
+bool client_pool_destroy(ClientPool *pool);
+bool client_pool_grow(ClientPool *pool,int num_clients);
+Client *client_pool_attach(ClientPool *pool,int table,int id);
+bool client_pool_detach(ClientPool *pool,Client *client);
+#endif
+
+#endif /* BLACKJACK_H_ */
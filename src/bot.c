@@ -0,0 +1,87 @@
+/*
+ * bot.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bot.h"
+
+/**
+ * Sleeps for the think time, the rest of it if interrupted
+ */
+static void bot_think(Bot *bot) {
+	struct timespec left;
+	if (bot->think<=0) {
+		return;
+	}
+	left.tv_sec = (time_t)bot->think;
+	left.tv_nsec = (long)((bot->think-left.tv_sec)*1e9);
+	while (nanosleep(&left,&left)==-1 && errno==EINTR);
+}
+
+/**
+ * Starts counting rounds again for the new seat
+ */
+static void bot_attach(Strategy *strategy,Client *client) {
+	Bot *bot = strategy->data;
+	(void)client; // Every seat it takes counts from 0 again
+	bot->_played = 0;
+}
+
+static bool bot_answer(Strategy *strategy,Client *client,const Message *msg,Message *reply) {
+	Bot *bot = strategy->data;
+	Strategy *base = bot->base;
+	Seats seats; // The dealer and them as far as they know
+	switch (msg->op) {
+		case MSG_AMT:
+			reply->amount = BOT_BANKROLL;
+			return TRUE;
+		case MSG_BET:
+			bot_think(bot);
+			if (bot->rounds>0 && bot->_played==bot->rounds) { // Done, leave
+				reply->amount = 0;
+				return TRUE;
+			}
+			bot->_played++;
+			message_get_seats(msg,&seats,client->id);
+			seats.money[1] = BOT_BANKROLL;
+			reply->amount = (bot->bet>0) ? bot->bet : base->bet(base,&seats,1);
+			return TRUE;
+		case MSG_HIT:
+			bot_think(bot);
+			message_get_seats(msg,&seats,client->id);
+			reply->decision = base->hit(base,&seats,1);
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Makes bots that play with the base strategy. The bet must be a multiple
+ * of the table minimum and the think time is in seconds.
+ */
+Bot *bot_create(Strategy *base,Money bet,double think,long rounds) {
+	Bot *bot = malloc(sizeof(Bot));
+	assert(bot!=NULL);
+	assert(base!=NULL && bet>=0 && think>=0 && rounds>=0);
+	bot->base = base;
+	bot->bet = bet;
+	bot->think = think;
+	bot->rounds = rounds;
+	bot->_played = 0;
+	bot->strategy = *base;
+	bot->strategy.data = bot;
+	bot->strategy.answer = bot_answer;
+	bot->strategy.attach = bot_attach;
+	return bot;
+}
+
+bool bot_destroy(Bot *bot) {
+	assert(bot!=NULL);
+	free(bot);
+	return TRUE;
+}
@@ -0,0 +1,36 @@
+/*
+ * bot.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Synthetic players for load runs. The player processes answer with a
+ *  strategy after an optional think time, bet a fixed amount if given
+ *  and leave after so many rounds so a run ends on its own.
+ */
+#include "blackjack.h"
+#include "simulator.h"
+
+#ifndef BOT_H_
+#define BOT_H_
+
+// Money a bot sits down with, enough that it doesn't go broke in a run
+#ifndef BOT_BANKROLL
+#define BOT_BANKROLL MONEY(1000000)
+#endif
+
+#ifndef Bot
+typedef struct Bot {
+	Strategy *base; // Decides the bets and hits
+	Money bet; // Bet this every round, 0 lets base decide
+	double think; // Seconds to think before each bet and hit, 0 for none
+	long rounds; // Leave after this many, 0 plays until broke
+	long _played; // Rounds bet on at this seat, each player process has its own count
+	Strategy strategy; // Give this to the player processes
+} Bot;
+#endif
+
+Bot *bot_create(Strategy *base,Money bet,double think,long rounds);
+bool bot_destroy(Bot *bot);
+
+#endif /* BOT_H_ */
@@ -0,0 +1,335 @@
+/*
+ * hands.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  The SIMD versions do 16 (AVX2) or 8 (SSE2) hands at a time with the
+ *  same arithmetic as the scalar one and pick results with masks instead
+ *  of branching. AVX2 is only used if the cpu has it, anything that isn't
+ *  x86 uses the scalar version. Hands left over at the end of a batch are
+ *  always done by the scalar version.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blackjack.h"
+#include "hands.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HANDS_X86 1
+#endif
+
+// Arrays are aligned and padded to a whole AVX2 register
+#define HANDS_ALIGN 32
+#define HANDS_LANES 16
+
+// Set with hands_use(), the best the cpu has unless told otherwise
+static HandsPath hands_path = HANDS_AUTO;
+
+static int16_t *hands_alloc(int size) {
+	void *p = NULL;
+	assert(posix_memalign(&p,HANDS_ALIGN,size*sizeof(int16_t))==0);
+	memset(p,0,size*sizeof(int16_t));
+	return p;
+}
+
+Hands *hands_create(int size) {
+	Hands *hands = malloc(sizeof(Hands));
+	assert(hands != NULL);
+	assert(size>0);
+	size = (size+HANDS_LANES-1)/HANDS_LANES*HANDS_LANES;
+	hands->hard = hands_alloc(size);
+	hands->aces = hands_alloc(size);
+	hands->score = hands_alloc(size);
+	hands->busted = hands_alloc(size);
+	hands->outcome = hands_alloc(size);
+	hands->num_hands = 0;
+	hands->_size = size;
+	return hands;
+}
+
+bool hands_destroy(Hands *hands) {
+	assert(hands!=NULL);
+	free(hands->hard);
+	free(hands->aces);
+	free(hands->score);
+	free(hands->busted);
+	free(hands->outcome);
+	free(hands);
+	return TRUE;
+}
+
+/**
+ * Empties the first num_hands hands, as after player_init_round()
+ */
+void hands_clear(Hands *hands,int num_hands) {
+	assert(num_hands<=hands->_size);
+	hands->num_hands = num_hands;
+	memset(hands->hard,0,num_hands*sizeof(int16_t));
+	memset(hands->aces,0,num_hands*sizeof(int16_t));
+	memset(hands->score,0,num_hands*sizeof(int16_t));
+	memset(hands->busted,0,num_hands*sizeof(int16_t));
+	memset(hands->outcome,0,num_hands*sizeof(int16_t));
+}
+
+/**
+ * Copies the hand of the player in seat into hands[i]
+ */
+void hands_set(Hands *hands,int i,Seats *seats,int seat) {
+	assert(i<hands->_size);
+	hands->hard[i] = seats->_hard[seat];
+	hands->aces[i] = seats->_num_aces[seat];
+	hands->score[i] = seats->score[seat];
+	hands->busted[i] = seats->busted[seat];
+}
+
+/**
+ * What a card adds to the hard total, aces are 1
+ */
+int16_t hands_delta(Card card) {
+	return card_is_ace(card) ? 1 : card_value(card);
+}
+
+// ========================================= SCALAR =================================================
+
+/**
+ * Gives hands[i] the card worth deltas[i] (0 for no card) starting
+ * from start. Same as player_hit(), busted hands don't take cards.
+ */
+void hands_hit_scalar(Hands *hands,const int16_t *deltas,int start) {
+	int i;
+	for (i=start;i<hands->num_hands;i++) {
+		if (deltas[i]==0 || hands->busted[i]) {
+			continue;
+		}
+		hands->hard[i] += deltas[i];
+		hands->aces[i] += (deltas[i]==1);
+		hands->score[i] = hands->hard[i];
+		if (hands->aces[i]>0 && hands->hard[i]<=11) {
+			hands->score[i] += 10;
+		}
+		hands->busted[i] = hands->score[i]>21;
+	}
+}
+
+/**
+ * Same as player_cmp() for each hand against the dealer's
+ * hand at the same index, starting from start.
+ */
+void hands_cmp_scalar(Hands *hands,const Hands *dealers,int start) {
+	int i;
+	for (i=start;i<hands->num_hands;i++) {
+		if (hands->busted[i]) {
+			hands->outcome[i] = -1;
+		} else if (dealers->busted[i] || hands->score[i]>dealers->score[i]) {
+			hands->outcome[i] = 1;
+		} else if (hands->score[i]==dealers->score[i]) {
+			hands->outcome[i] = 0;
+		} else {
+			hands->outcome[i] = -1;
+		}
+	}
+}
+
+// ========================================= SCALAR =================================================
+
+#ifdef HANDS_X86
+
+// ========================================= SSE2 =================================================
+
+static int hands_hit_sse2(Hands *hands,const int16_t *deltas) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i ten = _mm_set1_epi16(10);
+	const __m128i twelve = _mm_set1_epi16(12);
+	const __m128i twentyone = _mm_set1_epi16(21);
+	int i;
+	for (i=0;i+8<=hands->num_hands;i+=8) {
+		__m128i d = _mm_loadu_si128((const __m128i *)&deltas[i]);
+		__m128i h = _mm_load_si128((__m128i *)&hands->hard[i]);
+		__m128i a = _mm_load_si128((__m128i *)&hands->aces[i]);
+		__m128i s = _mm_load_si128((__m128i *)&hands->score[i]);
+		__m128i b = _mm_load_si128((__m128i *)&hands->busted[i]);
+
+		// Hands that take a card
+		__m128i take = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(d,zero),_mm_cmpgt_epi16(b,zero)),_mm_set1_epi16(-1));
+		h = _mm_add_epi16(h,_mm_and_si128(d,take));
+		a = _mm_sub_epi16(a,_mm_and_si128(_mm_cmpeq_epi16(d,one),take)); // -1 where an ace
+		__m128i soft = _mm_and_si128(_mm_cmpgt_epi16(a,zero),_mm_cmplt_epi16(h,twelve));
+		__m128i score = _mm_add_epi16(h,_mm_and_si128(soft,ten));
+		s = _mm_or_si128(_mm_and_si128(take,score),_mm_andnot_si128(take,s));
+		b = _mm_or_si128(b,_mm_and_si128(_mm_and_si128(take,_mm_cmpgt_epi16(score,twentyone)),one));
+
+		_mm_store_si128((__m128i *)&hands->hard[i],h);
+		_mm_store_si128((__m128i *)&hands->aces[i],a);
+		_mm_store_si128((__m128i *)&hands->score[i],s);
+		_mm_store_si128((__m128i *)&hands->busted[i],b);
+	}
+	return i;
+}
+
+static int hands_cmp_sse2(Hands *hands,const Hands *dealers) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	int i;
+	for (i=0;i+8<=hands->num_hands;i+=8) {
+		__m128i s = _mm_load_si128((__m128i *)&hands->score[i]);
+		__m128i b = _mm_cmpgt_epi16(_mm_load_si128((__m128i *)&hands->busted[i]),zero);
+		__m128i ds = _mm_load_si128((__m128i *)&dealers->score[i]);
+		__m128i db = _mm_cmpgt_epi16(_mm_load_si128((__m128i *)&dealers->busted[i]),zero);
+
+		__m128i win = _mm_andnot_si128(b,_mm_or_si128(db,_mm_cmpgt_epi16(s,ds)));
+		__m128i tie = _mm_andnot_si128(_mm_or_si128(b,win),_mm_cmpeq_epi16(s,ds));
+		// 1 if won, 0 if tied else -1 (all bits set)
+		__m128i out = _mm_or_si128(_mm_and_si128(win,one),_mm_andnot_si128(_mm_or_si128(win,tie),_mm_set1_epi16(-1)));
+		_mm_store_si128((__m128i *)&hands->outcome[i],out);
+	}
+	return i;
+}
+
+// ========================================= SSE2 =================================================
+
+// ========================================= AVX2 =================================================
+
+__attribute__((target("avx2")))
+static int hands_hit_avx2(Hands *hands,const int16_t *deltas) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i ten = _mm256_set1_epi16(10);
+	const __m256i eleven = _mm256_set1_epi16(11);
+	const __m256i twentyone = _mm256_set1_epi16(21);
+	const __m256i all = _mm256_set1_epi16(-1);
+	int i;
+	for (i=0;i+16<=hands->num_hands;i+=16) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)&deltas[i]);
+		__m256i h = _mm256_load_si256((__m256i *)&hands->hard[i]);
+		__m256i a = _mm256_load_si256((__m256i *)&hands->aces[i]);
+		__m256i s = _mm256_load_si256((__m256i *)&hands->score[i]);
+		__m256i b = _mm256_load_si256((__m256i *)&hands->busted[i]);
+
+		// Hands that take a card
+		__m256i take = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi16(d,zero),_mm256_cmpgt_epi16(b,zero)),all);
+		h = _mm256_add_epi16(h,_mm256_and_si256(d,take));
+		a = _mm256_sub_epi16(a,_mm256_and_si256(_mm256_cmpeq_epi16(d,one),take)); // -1 where an ace
+		__m256i soft = _mm256_andnot_si256(_mm256_cmpgt_epi16(h,eleven),_mm256_cmpgt_epi16(a,zero));
+		__m256i score = _mm256_add_epi16(h,_mm256_and_si256(soft,ten));
+		s = _mm256_blendv_epi8(s,score,take);
+		b = _mm256_or_si256(b,_mm256_and_si256(_mm256_and_si256(take,_mm256_cmpgt_epi16(score,twentyone)),one));
+
+		_mm256_store_si256((__m256i *)&hands->hard[i],h);
+		_mm256_store_si256((__m256i *)&hands->aces[i],a);
+		_mm256_store_si256((__m256i *)&hands->score[i],s);
+		_mm256_store_si256((__m256i *)&hands->busted[i],b);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static int hands_cmp_avx2(Hands *hands,const Hands *dealers) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i all = _mm256_set1_epi16(-1);
+	int i;
+	for (i=0;i+16<=hands->num_hands;i+=16) {
+		__m256i s = _mm256_load_si256((__m256i *)&hands->score[i]);
+		__m256i b = _mm256_cmpgt_epi16(_mm256_load_si256((__m256i *)&hands->busted[i]),zero);
+		__m256i ds = _mm256_load_si256((__m256i *)&dealers->score[i]);
+		__m256i db = _mm256_cmpgt_epi16(_mm256_load_si256((__m256i *)&dealers->busted[i]),zero);
+
+		__m256i win = _mm256_andnot_si256(b,_mm256_or_si256(db,_mm256_cmpgt_epi16(s,ds)));
+		__m256i tie = _mm256_andnot_si256(_mm256_or_si256(b,win),_mm256_cmpeq_epi16(s,ds));
+		// 1 if won, 0 if tied else -1 (all bits set)
+		__m256i out = _mm256_or_si256(_mm256_and_si256(win,one),_mm256_andnot_si256(_mm256_or_si256(win,tie),all));
+		_mm256_store_si256((__m256i *)&hands->outcome[i],out);
+	}
+	return i;
+}
+
+// ========================================= AVX2 =================================================
+
+/**
+ * Returns TRUE if the cpu can do AVX2, only checked once
+ */
+static bool hands_have_avx2() {
+	static int have = -1;
+	if (have==-1) {
+		__builtin_cpu_init();
+		have = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return have==1;
+}
+
+/**
+ * The version to use, the best the cpu has for HANDS_AUTO
+ */
+static HandsPath hands_pick() {
+	if (hands_path==HANDS_AUTO) {
+		return hands_have_avx2() ? HANDS_AVX2 : HANDS_SSE2;
+	}
+	return hands_path;
+}
+
+#endif
+
+/**
+ * Makes hands_hit() and hands_cmp() use the given version so they can
+ * be checked against each other. returns FALSE if the cpu can't do it.
+ */
+bool hands_use(HandsPath path) {
+#ifdef HANDS_X86
+	if (path==HANDS_AVX2 && !hands_have_avx2()) {
+		return FALSE;
+	}
+#else
+	if (path==HANDS_SSE2 || path==HANDS_AVX2) {
+		return FALSE;
+	}
+#endif
+	hands_path = path;
+	return TRUE;
+}
+
+/**
+ * Gives hands[i] the card worth deltas[i] (see hands_delta, 0 for no
+ * card). Gives the same results as player_hit() on each of them.
+ */
+void hands_hit(Hands *hands,const int16_t *deltas) {
+	int done = 0;
+#ifdef HANDS_X86
+	switch (hands_pick()) {
+		case HANDS_AVX2:
+			done = hands_hit_avx2(hands,deltas);
+			break;
+		case HANDS_SSE2:
+			done = hands_hit_sse2(hands,deltas);
+			break;
+		default:
+			break;
+	}
+#endif
+	hands_hit_scalar(hands,deltas,done);
+}
+
+/**
+ * Compares each hand to the dealer's hand at the same index and
+ * puts the result in outcome, same as player_cmp().
+ */
+void hands_cmp(Hands *hands,const Hands *dealers) {
+	int done = 0;
+	assert(dealers->num_hands>=hands->num_hands);
+#ifdef HANDS_X86
+	switch (hands_pick()) {
+		case HANDS_AVX2:
+			done = hands_cmp_avx2(hands,dealers);
+			break;
+		case HANDS_SSE2:
+			done = hands_cmp_sse2(hands,dealers);
+			break;
+		default:
+			break;
+	}
+#endif
+	hands_cmp_scalar(hands,dealers,done);
+}
@@ -0,0 +1,48 @@
+/*
+ * hands.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Scores and compares many hands at once. The hands are kept as arrays
+ *  (one per field) so they can be worked on with SSE2/AVX2, the results
+ *  are the same as player_hit() and player_cmp() one at a time.
+ */
+#include <stdint.h>
+#include "blackjack.h"
+
+#ifndef HANDS_H_
+#define HANDS_H_
+
+#ifndef HandsPath
+// Which version of the batch functions is used
+typedef enum { HANDS_AUTO,HANDS_SCALAR,HANDS_SSE2,HANDS_AVX2 } HandsPath;
+#endif
+
+#ifndef Hands
+/**
+ * A batch of hands, hands[i] is made of hard[i], aces[i], etc..
+ */
+typedef struct Hands {
+	int16_t *hard; // Total counting aces as 1
+	int16_t *aces; // Number of aces
+	int16_t *score; // Best total, same as Player.score
+	int16_t *busted; // 1 if busted
+	int16_t *outcome; // 1 won, 0 tied, -1 lost (see hands_cmp)
+	int num_hands;
+	int _size; // Room for this many
+} Hands;
+#endif
+
+Hands *hands_create(int size);
+bool hands_destroy(Hands *hands);
+void hands_clear(Hands *hands,int num_hands);
+void hands_set(Hands *hands,int i,Seats *seats,int seat);
+int16_t hands_delta(Card card);
+void hands_hit(Hands *hands,const int16_t *deltas);
+void hands_cmp(Hands *hands,const Hands *dealers);
+void hands_hit_scalar(Hands *hands,const int16_t *deltas,int start);
+void hands_cmp_scalar(Hands *hands,const Hands *dealers,int start);
+bool hands_use(HandsPath path);
+
+#endif /* HANDS_H_ */
@@ -4,13 +4,13 @@
  *  Created on: Feb 13, 2014
  *      Author: jrm
  */
+#ifndef HELPERS_H_
+#define HELPERS_H_
+
 #ifndef bool
 typedef enum { FALSE, TRUE } bool;
 #endif
 
-#ifndef HELPERS_H_
-#define HELPERS_H_
-
 int h_mk_argv(const char *s, const char *delimiters, char ***argvp);
 pid_t h_run_cmd(const char *cmd,const bool wait);
 int h_len(const char** array);
@@ -0,0 +1,75 @@
+/*
+ * history.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "restart.h"
+#include "history.h"
+
+_Static_assert(sizeof(HistoryRecord)==16,"HistoryRecord should be 16 bytes");
+
+/**
+ * Opens path to append to, the header is written if it's a new file.
+ * returns NULL if it can't be opened.
+ */
+History *history_create(const char *path) {
+	struct stat st;
+	int fd = r_open3(path,O_WRONLY|O_CREAT|O_APPEND,0644);
+	if (fd==-1) {
+		return NULL;
+	}
+	History *history = malloc(sizeof(History));
+	assert(history!=NULL);
+	history->fd = fd;
+	history->_size = HISTORY_BUF_SIZE;
+	history->buf = malloc(history->_size);
+	assert(history->buf!=NULL);
+	history->_used = 0;
+	history->records = 0;
+	history->error = 0;
+	if (fstat(fd,&st)==0 && st.st_size==0) {
+		memcpy(history->buf,HISTORY_MAGIC,8);
+		history->_used = 8;
+	}
+	return history;
+}
+
+/**
+ * Writes out whatever is buffered. Once a write fails the rest is dropped
+ * so the file stays whole up to there. returns FALSE if any write has
+ * failed, errno is set to why the first one did.
+ */
+bool history_flush(History *history) {
+	if (history->_used>0 && history->error==0 &&
+			r_write(history->fd,history->buf,history->_used)!=(ssize_t)history->_used) {
+		history->error = errno ? errno : EIO; // A short write doesn't set errno
+	}
+	history->_used = 0;
+	if (history->error!=0) {
+		errno = history->error;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Flushes and closes the file. returns FALSE if anything couldn't be
+ * written, errno is set to why.
+ */
+bool history_destroy(History *history) {
+	assert(history!=NULL);
+	bool ok = history_flush(history);
+	int error = history->error;
+	assert(r_close(history->fd)!=-1);
+	free(history->buf);
+	free(history);
+	errno = error;
+	return ok;
+}
@@ -0,0 +1,89 @@
+/*
+ * history.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Binary hand history. Every shuffle, card, bet, decision and payout at
+ *  the tables is appended to a file as a fixed size record so it can be
+ *  read back without parsing text. The file starts with HISTORY_MAGIC and
+ *  records are in host byte order. Each run starts with its settings
+ *  (HIST_SESSION and HIST_SHOE) so it can be replayed, see replay.h.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "helpers.h"
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#define HISTORY_MAGIC "BJHIST01" // 8 bytes, written once when the file is new
+#define HISTORY_BUF_SIZE (1<<20) // Bytes buffered before they're written out
+
+#ifndef HistoryType
+/**
+ * What a record is, with what's in value and amount
+ */
+typedef enum {
+	HIST_SHUFFLE=1, // value: RngType, amount: seed, the table id is the rng stream
+	HIST_ROUND, // amount: rounds played at the table so far
+	HIST_JOIN, // amount: money they sat down with
+	HIST_CARD, // value: Card dealt, player 0 is the dealer
+	HIST_BET, // amount: bet
+	HIST_DECISION, // value: TRUE to hit
+	HIST_PAYOUT, // amount: won, 0 if tied or minus the bet if lost
+	HIST_LEAVE, // amount: money they left with
+	HIST_SESSION, // Starts a run of the dealer. table: number of tables, player: players per table, value: RngType, amount: seed
+	HIST_SHOE // value: number of decks, amount: penetration in millionths
+} HistoryType;
+#endif
+
+#ifndef HistoryRecord
+typedef struct HistoryRecord {
+	unsigned char type; // HistoryType
+	unsigned char player; // Player id
+	unsigned char value;
+	unsigned char _pad;
+	uint32_t table; // Table id
+	int64_t amount; // Money is in cents
+} HistoryRecord;
+#endif
+
+#ifndef History
+/**
+ * Buffered writer for a history file, records are only written out
+ * in large blocks (or when flushed).
+ */
+typedef struct History {
+	int fd;
+	char *buf;
+	size_t _size; // Room in buf
+	size_t _used;
+	long records; // Records added
+	int error; // errno of the first write that failed, nothing is written after it. 0 if none
+} History;
+#endif
+
+History *history_create(const char *path);
+bool history_destroy(History *history);
+bool history_flush(History *history);
+
+/**
+ * Appends a record, the file is only written to once the buffer fills.
+ */
+static inline void history_add(History *history,HistoryType type,int table,int player,int value,int64_t amount) {
+	if (history->_used+sizeof(HistoryRecord)>history->_size) {
+		history_flush(history);
+	}
+	HistoryRecord *record = (HistoryRecord *)(history->buf+history->_used);
+	record->type = type;
+	record->player = player;
+	record->value = value;
+	record->_pad = 0;
+	record->table = table;
+	record->amount = amount;
+	history->_used += sizeof(HistoryRecord);
+	history->records++;
+}
+
+#endif /* HISTORY_H_ */
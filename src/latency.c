@@ -0,0 +1,94 @@
+/*
+ * latency.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "latency.h"
+
+volatile sig_atomic_t latency_dump_requested = 0;
+
+static const char *latency_names[LAT_NUM_PHASES] = {"bets","decision","turn","dealer","settle","round","send","recv"};
+
+/**
+ * Creates a histogram for every phase, index it with LatencyPhase
+ */
+Latency *latency_create() {
+	Latency *latency = calloc(LAT_NUM_PHASES,sizeof(Latency));
+	assert(latency!=NULL);
+	return latency;
+}
+
+bool latency_destroy(Latency *latency) {
+	assert(latency!=NULL);
+	free(latency);
+	return TRUE;
+}
+
+const char *latency_name(LatencyPhase phase) {
+	return latency_names[phase];
+}
+
+/**
+ * Highest value that lands in the same bucket as i
+ */
+static uint64_t latency_bucket_value(int i) {
+	if (i<LATENCY_SUB) {
+		return i;
+	}
+	int shift = i/LATENCY_SUB-1;
+	uint64_t sub = i%LATENCY_SUB;
+	return ((LATENCY_SUB+sub+1)<<shift)-1;
+}
+
+/**
+ * Returns the value p (0-1) of the recorded values are at or below
+ */
+uint64_t latency_percentile(const Latency *hist,double p) {
+	uint64_t total = atomic_load_explicit(&hist->total,memory_order_relaxed);
+	uint64_t rank = (uint64_t)(p*total+0.5);
+	uint64_t seen = 0;
+	int i;
+	if (rank<1) {
+		rank = 1;
+	}
+	for (i=0;i<LATENCY_BUCKETS;i++) {
+		seen += atomic_load_explicit(&hist->counts[i],memory_order_relaxed);
+		if (seen>=rank) {
+			uint64_t max = atomic_load_explicit(&hist->max,memory_order_relaxed);
+			uint64_t value = latency_bucket_value(i);
+			return value<max ? value : max;
+		}
+	}
+	return atomic_load_explicit(&hist->max,memory_order_relaxed);
+}
+
+/**
+ * Prints a line per phase with the count and percentiles in microseconds
+ */
+void latency_dump(Latency *latency,FILE *out) {
+	int i;
+	fprintf(out,"%-10s %10s %10s %10s %10s %10s %10s %10s\n","phase","count","mean(us)","p50","p90","p99","p99.9","max");
+	for (i=0;i<LAT_NUM_PHASES;i++) {
+		Latency *hist = &latency[i];
+		uint64_t total = atomic_load_explicit(&hist->total,memory_order_relaxed);
+		uint64_t sum = atomic_load_explicit(&hist->sum,memory_order_relaxed);
+		fprintf(out,"%-10s %10" PRIu64 " %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",latency_name(i),total,
+				total ? sum/1e3/total : 0.0,
+				latency_percentile(hist,0.5)/1e3,latency_percentile(hist,0.9)/1e3,
+				latency_percentile(hist,0.99)/1e3,latency_percentile(hist,0.999)/1e3,
+				atomic_load_explicit(&hist->max,memory_order_relaxed)/1e3);
+	}
+	fflush(out);
+}
+
+/**
+ * Signal handler (for SIGUSR1) asking for the histograms to be dumped,
+ * it only sets a flag since printing isn't safe in a handler.
+ */
+void latency_on_signal(int signo) {
+	latency_dump_requested = 1;
+}
@@ -0,0 +1,111 @@
+/*
+ * latency.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Latency histograms for the phases of a round at the tables. Buckets
+ *  are log-linear like an HDR histogram (each power of 2 is split into
+ *  LATENCY_SUB buckets, so about 6% resolution from 1ns up). Only the
+ *  dealer writes them, with relaxed atomics so they can be read while
+ *  they're written.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "helpers.h"
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB (1<<LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS (61*LATENCY_SUB) // Enough for any uint64_t
+
+#ifndef LatencyPhase
+typedef enum {
+	LAT_BETS, // Asking for bets until they're all in
+	LAT_DECISION, // Asking a player to hit until they answer
+	LAT_TURN, // A player's whole turn
+	LAT_DEALER, // The dealer drawing
+	LAT_SETTLE, // Paying out
+	LAT_ROUND, // Start of a round to the end of it
+	LAT_SEND, // Writing a message to a player
+	LAT_RECV, // Reading a message from a player
+	LAT_NUM_PHASES
+} LatencyPhase;
+#endif
+
+#ifndef Latency
+/**
+ * Histogram of nanoseconds
+ */
+typedef struct Latency {
+	_Atomic uint64_t counts[LATENCY_BUCKETS];
+	_Atomic uint64_t total; // Values recorded
+	_Atomic uint64_t sum;
+	_Atomic uint64_t max;
+} Latency;
+#endif
+
+// Set by latency_on_signal, whoever runs the loop dumps and clears it
+extern volatile sig_atomic_t latency_dump_requested;
+
+Latency *latency_create();
+bool latency_destroy(Latency *latency);
+const char *latency_name(LatencyPhase phase);
+uint64_t latency_percentile(const Latency *hist,double p);
+void latency_dump(Latency *latency,FILE *out);
+void latency_on_signal(int signo);
+
+/**
+ * Monotonic time in nanoseconds
+ */
+static inline uint64_t latency_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (uint64_t)now.tv_sec*1000000000ULL+now.tv_nsec;
+}
+
+static inline int latency_bucket(uint64_t ns) {
+	if (ns<LATENCY_SUB) {
+		return (int)ns;
+	}
+	int shift = 63-__builtin_clzll(ns)-LATENCY_SUB_BITS;
+	return (shift+1)*LATENCY_SUB+(int)((ns>>shift)&(LATENCY_SUB-1));
+}
+
+/**
+ * Only the dealer's thread writes, so a plain load and store is
+ * enough and readers never see a torn value
+ */
+static inline void latency_add(_Atomic uint64_t *value,uint64_t n) {
+	atomic_store_explicit(value,atomic_load_explicit(value,memory_order_relaxed)+n,memory_order_relaxed);
+}
+
+/**
+ * Adds ns to the histogram for the phase. latency is the array
+ * from latency_create.
+ */
+static inline void latency_record(Latency *latency,LatencyPhase phase,uint64_t ns) {
+	Latency *hist = &latency[phase];
+	latency_add(&hist->counts[latency_bucket(ns)],1);
+	latency_add(&hist->total,1);
+	latency_add(&hist->sum,ns);
+	if (ns>atomic_load_explicit(&hist->max,memory_order_relaxed)) {
+		atomic_store_explicit(&hist->max,ns,memory_order_relaxed);
+	}
+}
+
+/**
+ * Records the time since start, returns now so spans can be chained
+ */
+static inline uint64_t latency_since(Latency *latency,LatencyPhase phase,uint64_t start) {
+	uint64_t now = latency_now();
+	latency_record(latency,phase,now-start);
+	return now;
+}
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,261 @@
+/*
+ * metrics.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ */
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "restart.h"
+#include "metrics.h"
+
+#define METRICS_BUF_SIZE 16384 // Room for the whole text format
+
+/**
+ * A counter that's exported, found by its offset in the page
+ */
+typedef struct MetricsEntry {
+	char *name;
+	char *type; // counter or gauge
+	char *help;
+	size_t offset;
+} MetricsEntry;
+
+#define METRICS_COUNTER(field,help) {"blackjack_" #field "_total","counter",help,offsetof(MetricsPage,field)}
+#define METRICS_GAUGE(field,help) {"blackjack_" #field,"gauge",help,offsetof(MetricsPage,field)}
+
+static const MetricsEntry metrics_entries[] = {
+	METRICS_COUNTER(rounds,"Rounds played at all tables"),
+	METRICS_COUNTER(hands,"Player hands settled"),
+	METRICS_COUNTER(wins,"Hands won by the player"),
+	METRICS_COUNTER(pushes,"Hands tied with the dealer"),
+	METRICS_COUNTER(losses,"Hands lost by the player"),
+	METRICS_COUNTER(blackjacks,"Hands with 21 on the first two cards"),
+	METRICS_COUNTER(busts,"Player hands that went over 21"),
+	METRICS_COUNTER(joins,"Players that sat down"),
+	METRICS_COUNTER(leaves,"Players that left"),
+	METRICS_GAUGE(players,"Players at the tables"),
+	METRICS_GAUGE(bankroll,"Cents the players at the tables have"),
+	METRICS_COUNTER(wagered,"Cents bet"),
+};
+
+/**
+ * Answers everyone that connects with the current metrics and hangs up.
+ * Stops once the socket is shut down.
+ */
+static void *metrics_serve(void *arg) {
+	Metrics *metrics = arg;
+	char *buf = malloc(METRICS_BUF_SIZE);
+	int fd,n;
+	assert(buf!=NULL);
+	while (TRUE) {
+		fd = accept(metrics->fd,NULL,NULL);
+		if (fd==-1) {
+			if (errno==EINTR || errno==ECONNABORTED) {
+				continue;
+			}
+			break;
+		}
+		n = metrics_format(metrics,buf,METRICS_BUF_SIZE);
+		if (n>=METRICS_BUF_SIZE) {
+			n = METRICS_BUF_SIZE-1;
+		}
+		r_write(fd,buf,n);
+		r_close(fd);
+	}
+	free(buf);
+	return NULL;
+}
+
+/**
+ * Where the page for the socket at path goes, free it when done
+ */
+static char *metrics_page_name(const char *path) {
+	char *name = malloc(strlen(path)+sizeof(".page"));
+	assert(name!=NULL);
+	sprintf(name,"%s.page",path);
+	return name;
+}
+
+/**
+ * Maps path.page for the counters, or anonymous memory if it can't be
+ * shared. returns NULL if the file can't be made.
+ */
+static MetricsPage *metrics_map(const char *path) {
+	MetricsPage *page;
+	char *name;
+	int fd;
+	if (path==NULL) {
+		page = mmap(NULL,sizeof(MetricsPage),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+		return page==MAP_FAILED ? NULL : page;
+	}
+	name = metrics_page_name(path);
+	fd = r_open3(name,O_RDWR|O_CREAT|O_TRUNC,0644);
+	free(name);
+	if (fd==-1) {
+		return NULL;
+	}
+	if (ftruncate(fd,sizeof(MetricsPage))==-1) {
+		r_close(fd);
+		return NULL;
+	}
+	page = mmap(NULL,sizeof(MetricsPage),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	r_close(fd);
+	return page==MAP_FAILED ? NULL : page;
+}
+
+/**
+ * Frees what was set up so far when metrics_create fails, keeps errno
+ */
+static Metrics *metrics_fail(Metrics *metrics) {
+	int error = errno;
+	metrics_destroy(metrics);
+	errno = error;
+	return NULL;
+}
+
+/**
+ * Creates the counters. If path is given they're also shared in path.page
+ * and served on a Unix socket at path. latency is exported with them if
+ * it's not NULL. returns NULL if any of it can't be set up.
+ */
+Metrics *metrics_create(const char *path,Latency *latency) {
+	struct sockaddr_un addr;
+	sigset_t all,old;
+	struct timespec now;
+	Metrics *metrics = malloc(sizeof(Metrics));
+	assert(metrics!=NULL);
+	metrics->latency = latency;
+	metrics->path = NULL;
+	metrics->fd = -1;
+	metrics->serving = FALSE;
+	metrics->page = metrics_map(path);
+	if (metrics->page==NULL) {
+		free(metrics);
+		return NULL;
+	}
+	memset(metrics->page,0,sizeof(MetricsPage));
+	clock_gettime(CLOCK_REALTIME,&now);
+	metrics->page->started = (int64_t)now.tv_sec*1000000000LL+now.tv_nsec;
+	metrics->page->version = METRICS_VERSION;
+	metrics->page->magic = METRICS_MAGIC; // Last so readers see a complete page
+	if (path==NULL) {
+		return metrics;
+	}
+
+	// Serve them
+	metrics->path = strdup(path);
+	assert(metrics->path!=NULL);
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path)>=sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return metrics_fail(metrics);
+	}
+	strcpy(addr.sun_path,path);
+	unlink(path);
+	metrics->fd = socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+	if (metrics->fd==-1 || bind(metrics->fd,(struct sockaddr *)&addr,sizeof(addr))==-1 || listen(metrics->fd,16)==-1) {
+		return metrics_fail(metrics);
+	}
+	// The thread starts with every signal blocked so SIGINT, SIGUSR1
+	// and the rest always go to the dealer's thread
+	sigfillset(&all);
+	assert(pthread_sigmask(SIG_SETMASK,&all,&old)==0);
+	errno = pthread_create(&metrics->thread,NULL,metrics_serve,metrics);
+	assert(pthread_sigmask(SIG_SETMASK,&old,NULL)==0);
+	if (errno!=0) {
+		return metrics_fail(metrics);
+	}
+	metrics->serving = TRUE;
+	return metrics;
+}
+
+/**
+ * Stops serving, removes the socket and the page
+ */
+bool metrics_destroy(Metrics *metrics) {
+	char *name;
+	assert(metrics!=NULL);
+	if (metrics->serving) {
+		shutdown(metrics->fd,SHUT_RDWR); // Wakes up accept
+		assert(pthread_join(metrics->thread,NULL)==0);
+	}
+	if (metrics->fd!=-1) {
+		r_close(metrics->fd);
+	}
+	if (metrics->path!=NULL) {
+		unlink(metrics->path);
+		name = metrics_page_name(metrics->path);
+		unlink(name);
+		free(name);
+		free(metrics->path);
+	}
+	assert(munmap(metrics->page,sizeof(MetricsPage))==0);
+	free(metrics);
+	return TRUE;
+}
+
+/**
+ * Writes the metrics in the Prometheus text format into buf. Works
+ * like snprintf, returns what the length would be.
+ */
+int metrics_format(Metrics *metrics,char *buf,size_t size) {
+	MetricsPage *page = metrics->page;
+	struct timespec now;
+	size_t n=0;
+	int i,j;
+
+	// Keeps going if it runs out of room so the length is right
+	#define METRICS_PRINTF(...) n += snprintf(buf+(n<size ? n : size),n<size ? size-n : 0,__VA_ARGS__)
+
+	for (i=0;i<sizeof(metrics_entries)/sizeof(MetricsEntry);i++) {
+		const MetricsEntry *entry = &metrics_entries[i];
+		const MetricsCounter *counter = (const MetricsCounter *)((const char *)page+entry->offset);
+		METRICS_PRINTF("# HELP %s %s\n# TYPE %s %s\n%s %" PRId64 "\n",entry->name,entry->help,entry->name,entry->type,entry->name,metrics_get(counter));
+	}
+
+	// Per seat
+	METRICS_PRINTF("# HELP blackjack_messages_sent_total Messages sent to players\n# TYPE blackjack_messages_sent_total counter\n");
+	for (i=1;i<METRICS_SEATS;i++) {
+		METRICS_PRINTF("blackjack_messages_sent_total{seat=\"%i\"} %" PRId64 "\n",i,metrics_get(&page->sent[i]));
+	}
+	METRICS_PRINTF("# HELP blackjack_messages_received_total Messages received from players\n# TYPE blackjack_messages_received_total counter\n");
+	for (i=1;i<METRICS_SEATS;i++) {
+		METRICS_PRINTF("blackjack_messages_received_total{seat=\"%i\"} %" PRId64 "\n",i,metrics_get(&page->received[i]));
+	}
+
+	// Rates since the start
+	clock_gettime(CLOCK_REALTIME,&now);
+	double uptime = ((int64_t)now.tv_sec*1000000000LL+now.tv_nsec-page->started)/1e9;
+	METRICS_PRINTF("# HELP blackjack_uptime_seconds Seconds the dealer has been running\n# TYPE blackjack_uptime_seconds gauge\nblackjack_uptime_seconds %0.3f\n",uptime);
+	METRICS_PRINTF("# HELP blackjack_hands_per_second Hands settled per second since the start\n# TYPE blackjack_hands_per_second gauge\nblackjack_hands_per_second %0.1f\n",uptime>0 ? metrics_get(&page->hands)/uptime : 0.0);
+
+	// Phases of a round
+	if (metrics->latency!=NULL) {
+		static const double quantiles[] = {0.5,0.9,0.99,0.999};
+		METRICS_PRINTF("# HELP blackjack_latency_seconds Time taken by each phase of a round\n# TYPE blackjack_latency_seconds summary\n");
+		for (i=0;i<LAT_NUM_PHASES;i++) {
+			Latency *hist = &metrics->latency[i];
+			for (j=0;j<sizeof(quantiles)/sizeof(double);j++) {
+				METRICS_PRINTF("blackjack_latency_seconds{phase=\"%s\",quantile=\"%g\"} %0.9f\n",latency_name(i),quantiles[j],latency_percentile(hist,quantiles[j])/1e9);
+			}
+			METRICS_PRINTF("blackjack_latency_seconds_sum{phase=\"%s\"} %0.9f\n",latency_name(i),atomic_load_explicit(&hist->sum,memory_order_relaxed)/1e9);
+			METRICS_PRINTF("blackjack_latency_seconds_count{phase=\"%s\"} %" PRIu64 "\n",latency_name(i),atomic_load_explicit(&hist->total,memory_order_relaxed));
+		}
+	}
+	#undef METRICS_PRINTF
+	return (int)n;
+}
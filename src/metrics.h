@@ -0,0 +1,88 @@
+/*
+ * metrics.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Running counters for the tables. They live in a page of shared memory
+ *  (a file another process can mmap and poll) with every counter on its
+ *  own cache line, and can be served in the Prometheus text format on a
+ *  Unix socket by a thread of their own so the dealer never waits on a
+ *  reader.
+ */
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "helpers.h"
+#include "latency.h"
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#define METRICS_MAGIC 0x4d4a4b42 // "BKJM"
+#define METRICS_VERSION 1
+#define METRICS_SEATS 7 // Player ids 1-6, 0 is the dealer
+
+#ifndef MetricsCounter
+/**
+ * One counter to a cache line so readers don't slow down the dealer
+ */
+typedef struct MetricsCounter {
+	_Atomic int64_t value;
+} __attribute__((aligned(64))) MetricsCounter;
+#endif
+
+#ifndef MetricsPage
+/**
+ * What's in the shared memory. Only the dealer writes to it, readers
+ * should check magic and version first.
+ */
+typedef struct MetricsPage {
+	uint32_t magic;
+	uint32_t version;
+	int64_t started; // When the dealer started, ns since the epoch
+	MetricsCounter rounds;
+	MetricsCounter hands; // Player hands settled
+	MetricsCounter wins;
+	MetricsCounter pushes;
+	MetricsCounter losses;
+	MetricsCounter blackjacks; // 21 on the first two cards
+	MetricsCounter busts;
+	MetricsCounter joins; // Players that sat down
+	MetricsCounter leaves;
+	MetricsCounter players; // At the tables now
+	MetricsCounter bankroll; // Money the players at the tables have, in cents
+	MetricsCounter wagered; // In cents
+	MetricsCounter sent[METRICS_SEATS]; // Messages to players, by player id
+	MetricsCounter received[METRICS_SEATS]; // Messages from players, by player id
+} MetricsPage;
+#endif
+
+#ifndef Metrics
+typedef struct Metrics {
+	MetricsPage *page;
+	char *path; // Socket, the page is path.page. NULL if not exported
+	int fd; // Listening socket, -1 if not exported
+	pthread_t thread; // Serves the socket
+	bool serving; // thread was started
+	Latency *latency; // Also exported if not NULL, owned by someone else
+} Metrics;
+#endif
+
+Metrics *metrics_create(const char *path,Latency *latency);
+bool metrics_destroy(Metrics *metrics);
+int metrics_format(Metrics *metrics,char *buf,size_t size);
+
+/**
+ * Adds n to the counter. Only the dealer thread writes so there's no
+ * need for a locked add, readers just see whole values.
+ */
+static inline void metrics_add(MetricsCounter *counter,int64_t n) {
+	atomic_store_explicit(&counter->value,atomic_load_explicit(&counter->value,memory_order_relaxed)+n,memory_order_relaxed);
+}
+
+static inline int64_t metrics_get(const MetricsCounter *counter) {
+	return atomic_load_explicit((_Atomic int64_t *)&counter->value,memory_order_relaxed);
+}
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,198 @@
+/*
+ * replay.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+#include "replay.h"
+
+static bool replay_strategy_answer(Strategy *strategy,Client *client,const Message *msg,Message *reply) {
+	return replay_answer(strategy->data,client->table,client->id,msg,reply);
+}
+
+static ReplayScript *replay_script(Replay *replay,int table,int id) {
+	if (table<0 || table>=replay->num_tables || id<1 || id>=SEATS_MAX) {
+		return NULL;
+	}
+	return &replay->scripts[table*SEATS_MAX+id];
+}
+
+static void replay_script_add(ReplayScript *script,MessageOp op,bool decision,Money amount) {
+	if (script->_num_answers==script->_size) {
+		script->_size = script->_size ? 2*script->_size : 64;
+		script->answers = realloc(script->answers,script->_size*sizeof(ReplayAnswer));
+		assert(script->answers!=NULL);
+	}
+	ReplayAnswer *answer = &script->answers[script->_num_answers++];
+	answer->op = op;
+	answer->decision = decision;
+	answer->amount = amount;
+}
+
+/**
+ * Reads the first session in a history file. returns NULL if the file
+ * can't be read, has no session in it or the settings in it are bad.
+ */
+Replay *replay_load(const char *path) {
+	HistoryRecord records[4096];
+	char magic[8];
+	size_t n;
+	int i;
+	FILE *file;
+	bool started = FALSE;
+	bool *settled = NULL; // By table, the round has had a payout. The last one has none, everyone left
+	Replay *replay = NULL;
+
+	file = fopen(path,"rb");
+	if (file==NULL) {
+		return NULL;
+	}
+	if (fread(magic,sizeof(magic),1,file)!=1 || memcmp(magic,HISTORY_MAGIC,sizeof(magic))!=0) {
+		fclose(file);
+		return NULL;
+	}
+	while ((n=fread(records,sizeof(HistoryRecord),sizeof(records)/sizeof(HistoryRecord),file))>0) {
+		for (i=0;i<n;i++) {
+			HistoryRecord *record = &records[i];
+			ReplayScript *script;
+			if (record->type==HIST_SESSION) {
+				if (started) { // Only the first
+					goto done;
+				}
+				started = TRUE;
+				if (record->table<1 || record->table>REPLAY_MAX_TABLES) {
+					fprintf(stderr,"%s: session has %u tables, can replay 1-%i\n",path,record->table,REPLAY_MAX_TABLES);
+					goto bad;
+				}
+				if (record->player<1 || record->player>SEATS_MAX-1) {
+					fprintf(stderr,"%s: session has %u players a table, can replay 1-%i\n",path,record->player,SEATS_MAX-1);
+					goto bad;
+				}
+				if (record->value!=RNG_XOSHIRO && record->value!=RNG_PCG) {
+					fprintf(stderr,"%s: session has an unknown rng %u\n",path,record->value);
+					goto bad;
+				}
+				replay = calloc(1,sizeof(Replay));
+				assert(replay!=NULL);
+				replay->num_tables = record->table;
+				replay->num_players = record->player;
+				replay->rng_type = record->value;
+				replay->seed = (uint64_t)record->amount;
+				replay->num_decks = 6;
+				replay->penetration = 0.75;
+				replay->scripts = calloc(replay->num_tables*SEATS_MAX,sizeof(ReplayScript));
+				assert(replay->scripts!=NULL);
+				settled = calloc(replay->num_tables,sizeof(bool));
+				assert(settled!=NULL);
+				continue;
+			}
+			if (!started) {
+				continue;
+			}
+			script = replay_script(replay,record->table,record->player);
+			switch (record->type) {
+				case HIST_SHOE:
+					if (record->value<1 || record->value>SHOE_MAX_DECKS || record->amount<=0 || record->amount>1000000) {
+						fprintf(stderr,"%s: shoe of %u decks cut at %lli millionths, can replay 1-%i decks cut at (0-1000000]\n",
+								path,record->value,(long long)record->amount,SHOE_MAX_DECKS);
+						goto bad;
+					}
+					replay->num_decks = record->value;
+					replay->penetration = record->amount/1e6;
+					break;
+				case HIST_ROUND:
+					if (record->table<replay->num_tables) {
+						settled[record->table] = FALSE;
+					}
+					break;
+				case HIST_PAYOUT:
+					if (record->table<replay->num_tables && !settled[record->table]) {
+						settled[record->table] = TRUE;
+						replay->rounds++;
+					}
+					break;
+				case HIST_JOIN:
+					if (script!=NULL) {
+						replay_script_add(script,MSG_AMT,FALSE,record->amount);
+					}
+					break;
+				case HIST_BET:
+					if (script!=NULL) {
+						replay_script_add(script,MSG_BET,FALSE,record->amount);
+					}
+					break;
+				case HIST_DECISION:
+					if (script!=NULL) {
+						replay_script_add(script,MSG_HIT,record->value,0);
+					}
+					break;
+			}
+		}
+	}
+done:
+	fclose(file);
+	free(settled);
+	if (replay!=NULL) {
+		replay->strategy.name = "replay";
+		replay->strategy.bet = NULL;
+		replay->strategy.hit = NULL;
+		replay->strategy.data = replay;
+		replay->strategy.answer = replay_strategy_answer;
+	}
+	return replay;
+bad:
+	fclose(file);
+	free(settled);
+	if (replay!=NULL) {
+		assert(replay_destroy(replay));
+	}
+	return NULL;
+}
+
+bool replay_destroy(Replay *replay) {
+	int i;
+	assert(replay!=NULL);
+	for (i=0;i<replay->num_tables*SEATS_MAX;i++) {
+		free(replay->scripts[i].answers);
+	}
+	free(replay->scripts);
+	free(replay);
+	return TRUE;
+}
+
+/**
+ * Answers for the player at the table the way they did in the recording.
+ * Once they run out of answers (or the next one is to something else)
+ * they leave, the same as they did. returns FALSE if msg isn't a question.
+ */
+bool replay_answer(Replay *replay,int table,int id,const Message *msg,Message *reply) {
+	ReplayScript *script = replay_script(replay,table,id);
+	ReplayAnswer *answer = NULL;
+	if (msg->op!=MSG_AMT && msg->op!=MSG_BET && msg->op!=MSG_HIT) {
+		return FALSE;
+	}
+	if (script!=NULL && script->next<script->_num_answers && script->answers[script->next].op==msg->op) {
+		answer = &script->answers[script->next++];
+	}
+	switch (msg->op) {
+		case MSG_AMT:
+			if (answer==NULL) { // Never sat down
+				reply->op = MSG_EXIT;
+			} else {
+				reply->amount = answer->amount;
+			}
+			break;
+		case MSG_BET:
+			reply->amount = (answer==NULL) ? 0 : answer->amount;
+			break;
+		case MSG_HIT:
+			reply->decision = (answer==NULL) ? FALSE : answer->decision;
+			break;
+	}
+	return TRUE;
+}
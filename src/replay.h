@@ -0,0 +1,65 @@
+/*
+ * replay.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Plays back a session recorded with --history. The settings and seed
+ *  come from the first session in the file and the player processes
+ *  answer with what the players answered back then, as fast as they can.
+ *  Since every table has its own stream of the same seed the same cards
+ *  come out as long as no one timed out in the recording.
+ */
+#include "blackjack.h"
+#include "simulator.h"
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+// Most tables a recording can have, past this it's taken to be corrupt
+#ifndef REPLAY_MAX_TABLES
+#define REPLAY_MAX_TABLES 65536
+#endif
+
+#ifndef ReplayAnswer
+/**
+ * What the player answered when asked op
+ */
+typedef struct ReplayAnswer {
+	unsigned char op; // MSG_AMT, MSG_BET or MSG_HIT
+	unsigned char decision;
+	Money amount;
+} ReplayAnswer;
+#endif
+
+#ifndef ReplayScript
+/**
+ * Answers of one player at one table in the order they were given
+ */
+typedef struct ReplayScript {
+	ReplayAnswer *answers;
+	int _num_answers;
+	int _size;
+	int next; // Next one to give
+} ReplayScript;
+#endif
+
+#ifndef Replay
+typedef struct Replay {
+	int num_tables;
+	int num_players; // At each table
+	int num_decks;
+	double penetration;
+	RngType rng_type;
+	uint64_t seed;
+	long rounds; // Rounds that were played out in the recording
+	ReplayScript *scripts; // [table*SEATS_MAX+id]
+	Strategy strategy; // Give this to the player processes
+} Replay;
+#endif
+
+Replay *replay_load(const char *path);
+bool replay_destroy(Replay *replay);
+bool replay_answer(Replay *replay,int table,int id,const Message *msg,Message *reply);
+
+#endif /* REPLAY_H_ */
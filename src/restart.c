@@ -277,6 +277,60 @@ int r_readline(int fd, char *buf, int nbytes) {
 	return -1;
 }
 
+/**
+ * sets up lb to buffer reads from the open file descriptor fd. Anything already
+ * buffered is dropped.
+ */
+void r_linebuf_init(RLineBuf *lb, int fd) {
+	lb->fd = fd;
+	lb->start = 0;
+	lb->end = 0;
+}
+
+/**
+ * behaves the same as r_readline but reads from the file descriptor of lb as
+ * many bytes as are available (up to RLINEBUF_SIZE) at a time and keeps what
+ * is past the newline for the next call. The file descriptor should only be
+ * read through lb once this is used. If interrupted by a signal the read is
+ * restarted.
+ */
+int r_readline_buffered(RLineBuf *lb, char *buf, int nbytes) {
+	int numread = 0;
+	int returnval;
+	char *nl;
+	int n;
+	while (numread < nbytes - 1) {
+		if (lb->start == lb->end) {
+			returnval = read(lb->fd, lb->buf, RLINEBUF_SIZE);
+			if ((returnval == -1) && (errno == EINTR))
+				continue;
+			if ((returnval == 0) && (numread == 0))
+				return 0;
+			if (returnval == 0)
+				break;
+			if (returnval == -1)
+				return -1;
+			lb->start = 0;
+			lb->end = returnval;
+		}
+		n = lb->end - lb->start;
+		if (n > nbytes - 1 - numread)
+			n = nbytes - 1 - numread;
+		nl = memchr(lb->buf + lb->start, '\n', n);
+		if (nl != NULL)
+			n = nl - (lb->buf + lb->start) + 1;
+		memcpy(buf + numread, lb->buf + lb->start, n);
+		lb->start += n;
+		numread += n;
+		if (nl != NULL) {
+			buf[numread] = '\0';
+			return numread;
+		}
+	}
+	errno = EINVAL;
+	return -1;
+}
+
 /**
  * attempts to read at most nbyte bytes from the open file descriptor fd into the
  * buffer buf. The r_readtimed function behaves the same as r_read unless no bytes
@@ -20,6 +20,23 @@
 #define ETIME ETIMEDOUT
 #endif
 
+#ifndef RLINEBUF_SIZE
+#define RLINEBUF_SIZE 4096
+#endif
+
+/**
+ * Read buffer for a file descriptor so lines can be read a chunk
+ * at a time instead of a byte at a time. Players talk in binary
+ * messages now, this is kept as the baseline r_readline is
+ * benchmarked against (see bench.c).
+ */
+typedef struct RLineBuf {
+	int fd;
+	int start; // Next byte not handed out yet
+	int end; // End of the bytes read in
+	char buf[RLINEBUF_SIZE];
+} RLineBuf;
+
 pid_t r_wait_all();
 struct timeval r_add2currenttime(double seconds);
 int r_copyfile(int fromfd, int tofd);
@@ -33,6 +50,8 @@ pid_t r_waitpid(pid_t pid, int *stat_loc, int options);
 ssize_t r_write(int fd, void *buf, size_t size);
 ssize_t r_readblock(int fd, void *buf, size_t size);
 int r_readline(int fd, char *buf, int nbytes);
+void r_linebuf_init(RLineBuf *lb, int fd);
+int r_readline_buffered(RLineBuf *lb, char *buf, int nbytes);
 ssize_t r_readtimed(int fd, void *buf, size_t nbyte, double seconds);
 int r_readwrite(int fromfd, int tofd);
 int r_readwriteblock(int fromfd, int tofd, char *buf, int size);
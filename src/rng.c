@@ -0,0 +1,221 @@
+/*
+ * rng.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Generators are from:
+ *     xoshiro256** by David Blackman and Sebastiano Vigna, http://prng.di.unimi.it/
+ *     PCG (pcg64, XSL-RR 128/64) by Melissa O'Neill, http://www.pcg-random.org/
+ *  Bounded numbers use:
+ *     Fast Random Integer Generation in an Interval, Daniel Lemire
+ */
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rng.h"
+
+// Multiplier for the 128 bit PCG LCG
+#define PCG_MULT_HI 2549297995355413924ULL
+#define PCG_MULT_LO 4865540595714422341ULL
+
+/**
+ * Used to spread a single 64 bit seed over the larger state
+ */
+static uint64_t splitmix64(uint64_t *x) {
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(const uint64_t x,int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// ========================================= XOSHIRO =================================================
+
+static uint64_t xoshiro_next(Rng *rng) {
+	uint64_t *s = rng->state;
+	const uint64_t result = rotl(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+/**
+ * Same as 2^128 calls to next, used to give each stream
+ * its own non-overlapping part of the sequence.
+ */
+static void xoshiro_jump(Rng *rng) {
+	static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+	uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i,b;
+	for (i = 0; i < sizeof(JUMP)/sizeof(*JUMP); i++) {
+		for (b = 0; b < 64; b++) {
+			if (JUMP[i] & (1ULL << b)) {
+				s0 ^= rng->state[0];
+				s1 ^= rng->state[1];
+				s2 ^= rng->state[2];
+				s3 ^= rng->state[3];
+			}
+			xoshiro_next(rng);
+		}
+	}
+	rng->state[0] = s0;
+	rng->state[1] = s1;
+	rng->state[2] = s2;
+	rng->state[3] = s3;
+}
+
+static void xoshiro_seed(Rng *rng,uint64_t seed) {
+	int i;
+	for (i=0;i<4;i++) {
+		rng->state[i] = splitmix64(&seed);
+	}
+}
+
+// ========================================= XOSHIRO =================================================
+
+// ========================================= PCG =================================================
+
+// State is kept in state[0..1] and the stream (increment) in state[2..3]
+static inline __uint128_t pcg_get(Rng *rng,int i) {
+	return ((__uint128_t)rng->state[i+1] << 64) | rng->state[i];
+}
+
+static inline void pcg_set(Rng *rng,int i,__uint128_t v) {
+	rng->state[i] = (uint64_t)v;
+	rng->state[i+1] = (uint64_t)(v >> 64);
+}
+
+static inline void pcg_step(Rng *rng) {
+	const __uint128_t mult = ((__uint128_t)PCG_MULT_HI << 64) | PCG_MULT_LO;
+	pcg_set(rng,0,pcg_get(rng,0)*mult + pcg_get(rng,2));
+}
+
+static uint64_t pcg_next(Rng *rng) {
+	pcg_step(rng);
+	uint64_t xored = rng->state[1] ^ rng->state[0];
+	int rot = (int)(rng->state[1] >> 58);
+	return (xored >> rot) | (xored << ((-rot) & 63));
+}
+
+static void pcg_seed(Rng *rng,uint64_t seed,uint64_t stream) {
+	uint64_t x = seed;
+	__uint128_t initstate = ((__uint128_t)splitmix64(&x) << 64) | splitmix64(&x);
+	pcg_set(rng,0,0);
+	pcg_set(rng,2,((__uint128_t)stream << 1) | 1); // Must be odd
+	pcg_step(rng);
+	pcg_set(rng,0,pcg_get(rng,0)+initstate);
+	pcg_step(rng);
+}
+
+// ========================================= PCG =================================================
+
+/**
+ * Seeds the generator. The same type and seed always give
+ * the same sequence.
+ */
+bool rng_init(Rng *rng,RngType type,uint64_t seed) {
+	rng->type = type;
+	rng->seed = seed;
+	switch (type) {
+		case RNG_XOSHIRO:
+			rng->next = xoshiro_next;
+			xoshiro_seed(rng,seed);
+			return TRUE;
+		case RNG_PCG:
+			rng->next = pcg_next;
+			pcg_seed(rng,seed,0);
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Makes rng an independent stream of base. Streams with different numbers
+ * never overlap so each thread (or game) can get its own.
+ */
+bool rng_stream(Rng *rng,const Rng *base,int stream) {
+	int i;
+	assert(stream>=0);
+	memcpy(rng,base,sizeof(Rng));
+	switch (rng->type) {
+		case RNG_XOSHIRO:
+			for (i=0;i<stream;i++) {
+				xoshiro_jump(rng);
+			}
+			return TRUE;
+		case RNG_PCG:
+			pcg_seed(rng,base->seed,(uint64_t)stream);
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Moves rng on from stream n of its base to stream n+1 in one step, so
+ * handing out streams in order doesn't take n jumps each. Nothing can
+ * have been drawn from rng since it was made a stream.
+ */
+bool rng_stream_next(Rng *rng) {
+	switch (rng->type) {
+		case RNG_XOSHIRO:
+			xoshiro_jump(rng);
+			return TRUE;
+		case RNG_PCG:
+			pcg_seed(rng,rng->seed,(uint64_t)(pcg_get(rng,2)>>1)+1);
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Looks up a generator by name. returns FALSE if there is none.
+ */
+bool rng_find_type(const char *name,RngType *type) {
+	if (strcmp(name,"xoshiro")==0) {
+		*type = RNG_XOSHIRO;
+	} else if (strcmp(name,"pcg")==0) {
+		*type = RNG_PCG;
+	} else {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Makes a seed for when none was given. Print it so the run can be repeated!
+ */
+uint64_t rng_make_seed() {
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME,&now);
+	uint64_t x = ((uint64_t)now.tv_sec << 32) ^ (uint64_t)now.tv_nsec ^ ((uint64_t)getpid() << 16);
+	return splitmix64(&x);
+}
+
+/**
+ * Returns a random number in [0,n) without modulo bias using
+ * Lemire's multiply and shift. Only rarely needs another draw.
+ */
+uint32_t rng_bounded(Rng *rng,uint32_t n) {
+	uint32_t x = (uint32_t)(rng_next(rng) >> 32);
+	uint64_t m = (uint64_t)x * n;
+	uint32_t l = (uint32_t)m;
+	if (l < n) {
+		uint32_t t = -n % n;
+		while (l < t) {
+			x = (uint32_t)(rng_next(rng) >> 32);
+			m = (uint64_t)x * n;
+			l = (uint32_t)m;
+		}
+	}
+	return (uint32_t)(m >> 32);
+}
@@ -0,0 +1,47 @@
+/*
+ * rng.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Seedable random number generators. Each game (or thread) owns its own
+ *  Rng so there is no shared state and runs can be reproduced from a seed.
+ */
+#include <stdint.h>
+#include "helpers.h"
+
+#ifndef RNG_H_
+#define RNG_H_
+
+#ifndef RngType
+typedef enum { RNG_XOSHIRO,RNG_PCG } RngType;
+#endif
+
+#ifndef Rng
+/**
+ * A random number generator. next returns 64 random bits, the state is
+ * only touched through it.
+ */
+typedef struct Rng {
+	RngType type;
+	uint64_t (*next)(struct Rng *rng);
+	uint64_t seed; // What it was seeded with
+	uint64_t state[4];
+} Rng;
+#endif
+
+bool rng_init(Rng *rng,RngType type,uint64_t seed);
+bool rng_stream(Rng *rng,const Rng *base,int stream);
+bool rng_stream_next(Rng *rng);
+bool rng_find_type(const char *name,RngType *type);
+uint64_t rng_make_seed();
+uint32_t rng_bounded(Rng *rng,uint32_t n);
+
+/**
+ * Returns the next 64 random bits
+ */
+static inline uint64_t rng_next(Rng *rng) {
+	return rng->next(rng);
+}
+
+#endif /* RNG_H_ */
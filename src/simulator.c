@@ -0,0 +1,334 @@
+/*
+ * simulator.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Plays rounds in-process using the same game code as the dealer
+ *  but without any player processes. Used for Monte Carlo runs.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "blackjack.h"
+#include "simulator.h"
+#include "basic.h"
+#include "rng.h"
+
+// Money every simulated player sits down (and re-buys) with
+#ifndef SIM_BANKROLL
+#define SIM_BANKROLL MONEY(1000000)
+#endif
+
+#ifndef SIM_CACHE_LINE
+#define SIM_CACHE_LINE 64
+#endif
+
+// The random strategy bets up to this many times the table minimum
+#ifndef STRATEGY_RANDOM_MAX_BETS
+#define STRATEGY_RANDOM_MAX_BETS 20
+#endif
+
+// Mixed into the run's seed so strategies don't draw from the same streams as the cards
+#define STRATEGY_SEED_SALT 0x5eed5eed5eed5eedULL
+
+static Rng strategy_base; // Set by strategy_init, streams of it are given out by strategy_seed
+static bool strategy_have_base = FALSE;
+static __thread Rng strategy_rng; // For the random strategy
+static __thread bool strategy_seeded = FALSE;
+
+// ========================================= STRATEGY =================================================
+
+/**
+ * Always bets the table minimum
+ */
+static Money strategy_bet_min(Strategy *strategy,Seats *seats,int seat) {
+	return MONEY_MIN_BET;
+}
+
+/**
+ * Plays the same as the dealer, hit on 16 or lower
+ */
+static bool strategy_hit_dealer(Strategy *strategy,Seats *seats,int seat) {
+	return seats->score[seat]<DEALER_STANDS;
+}
+
+/**
+ * Never takes a card
+ */
+static bool strategy_hit_never(Strategy *strategy,Seats *seats,int seat) {
+	return FALSE;
+}
+
+/**
+ * Plays basic strategy against the dealer's up card
+ */
+static bool strategy_hit_basic(Strategy *strategy,Seats *seats,int seat) {
+	return basic_player_hit(seats,seat);
+}
+
+/**
+ * Bets a random multiple of the table minimum
+ */
+static Money strategy_bet_random(Strategy *strategy,Seats *seats,int seat) {
+	assert(strategy_seeded);
+	return MONEY_MIN_BET*(1+rng_bounded(&strategy_rng,STRATEGY_RANDOM_MAX_BETS));
+}
+
+/**
+ * Flips a coin
+ */
+static bool strategy_hit_random(Strategy *strategy,Seats *seats,int seat) {
+	assert(strategy_seeded);
+	return rng_bounded(&strategy_rng,2);
+}
+
+static Strategy strategies[] = {
+	{"dealer",strategy_bet_min,strategy_hit_dealer,NULL},
+	{"stand",strategy_bet_min,strategy_hit_never,NULL},
+	{"basic",strategy_bet_min,strategy_hit_basic,NULL},
+	{"random",strategy_bet_random,strategy_hit_random,NULL},
+};
+
+/**
+ * Returns the built in strategy with the given name or NULL
+ * if there is none.
+ */
+Strategy *strategy_find(const char *name) {
+	int i;
+	for (i=0;i<sizeof(strategies)/sizeof(Strategy);i++) {
+		if (strcmp(strategies[i].name,name)==0) {
+			return &strategies[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Sets the generator strategies get their streams from, call it before
+ * any threads or player processes are started. It's always PCG, whatever
+ * the cards use, since picking any of its streams takes the same time.
+ */
+void strategy_init(const Rng *rng) {
+	assert(rng_init(&strategy_base,RNG_PCG,rng->seed^STRATEGY_SEED_SALT));
+	strategy_have_base = TRUE;
+}
+
+/**
+ * Gives this thread (or player process) its own stream for the random
+ * strategy so runs with the same seed play the same.
+ */
+void strategy_seed(int stream) {
+	assert(strategy_have_base);
+	assert(rng_stream(&strategy_rng,&strategy_base,stream));
+	strategy_seeded = TRUE;
+}
+
+/**
+ * Called in a player process when it sits down. The stream only depends
+ * on the seat so it's the same whichever process gets it.
+ */
+void strategy_attach(Strategy *strategy,Client *client) {
+	strategy_seed(client->table*SEATS_MAX+client->id);
+	if (strategy->attach!=NULL) {
+		strategy->attach(strategy,client);
+	}
+}
+
+// ========================================= STRATEGY =================================================
+
+// ========================================= SIMULATOR =================================================
+
+/**
+ * Plays the given number of rounds. Each seat (except the dealer at 0)
+ * is played by strategies[seat]. Results are added to stats.
+ */
+bool sim_run(Blackjack *game,Strategy *strategies[],long rounds,SimStats *stats) {
+	Seats *seats = &game->seats;
+	Strategy *strategy;
+	long r;
+	int i;
+
+	for (r=0;r<rounds;r++) {
+		assert(blackjack_init_round(game));
+
+		// Bets in, re-buy if they went broke
+		for (i=1;i<game->_num_players;i++) {
+			strategy = strategies[i];
+			Money bet = strategy->bet(strategy,seats,i);
+			if (seats->money[i]<bet) {
+				seats->money[i] += SIM_BANKROLL;
+			}
+			assert(player_bet(seats,i,bet));
+			stats->wagered += bet;
+		}
+
+		// Each seat plays their hand
+		for (i=1;i<game->_num_players;i++) {
+			strategy = strategies[i];
+			while (player_can_hit(seats,i) && strategy->hit(strategy,seats,i)) {
+				assert(blackjack_deal_card(game,i));
+			}
+		}
+
+		// Dealer plays last
+		while (!(seats->busted[0]) && (seats->score[0]<DEALER_STANDS)) {
+			assert(blackjack_deal_card(game,0));
+		}
+
+		// Settle up
+		for (i=1;i<game->_num_players;i++) {
+			Money won = player_settle(seats,i,0);
+			if (won>0) {
+				stats->wins++;
+			} else if (won==0) {
+				stats->pushes++;
+			} else {
+				stats->losses++;
+			}
+			if (seats->busted[i]) {
+				stats->busts++;
+			} else if (seats->blackjack[i]) {
+				stats->blackjacks++;
+			}
+			stats->net += won;
+			stats->hands++;
+		}
+		stats->rounds++;
+	}
+	return TRUE;
+}
+
+/**
+ * Adds the results in part to total
+ */
+void sim_stats_merge(SimStats *total,const SimStats *part) {
+	total->rounds += part->rounds;
+	total->hands += part->hands;
+	total->wins += part->wins;
+	total->pushes += part->pushes;
+	total->losses += part->losses;
+	total->blackjacks += part->blackjacks;
+	total->busts += part->busts;
+	total->wagered += part->wagered;
+	total->net += part->net;
+}
+
+/**
+ * State for one simulator thread. Everything a thread touches while playing
+ * is its own, so they never share a lock or a cache line.
+ */
+typedef struct SimWorker {
+	pthread_t thread;
+	int id; // Also the stream for the random strategy
+	int num_players;
+	int num_decks;
+	double penetration;
+	long rounds;
+	Strategy *strategy;
+	Rng rng; // Own stream of the base generator
+	SimStats stats;
+} __attribute__((aligned(SIM_CACHE_LINE))) SimWorker;
+
+/**
+ * Thread function, creates a game and plays this worker's share of the rounds
+ */
+static void *sim_worker_main(void *arg) {
+	SimWorker *worker = arg;
+	Strategy *seats[7];
+	Blackjack *game;
+	int i;
+
+	// Created by the thread so its memory is local to it
+	strategy_seed(worker->id);
+	game = blackjack_create(worker->num_players+1,worker->num_decks,worker->penetration,&worker->rng); // +1 for dealer
+	for (i=1;i<game->_num_players;i++) {
+		game->seats.money[i] = SIM_BANKROLL;
+		seats[i] = worker->strategy;
+	}
+	assert(sim_run(game,seats,worker->rounds,&worker->stats));
+	assert(blackjack_destroy(game));
+	return NULL;
+}
+
+/**
+ * Splits the rounds over num_threads threads, each with its own game
+ * and stream of rng. The results of all threads are merged into stats.
+ */
+bool sim_run_parallel(int num_players,long rounds,Strategy *strategy,int num_decks,double penetration,const Rng *rng,int num_threads,SimStats *stats) {
+	SimWorker *workers;
+	int i;
+
+	assert(num_threads>0);
+	assert(posix_memalign((void **)&workers,SIM_CACHE_LINE,num_threads*sizeof(SimWorker))==0);
+	memset(workers,0,num_threads*sizeof(SimWorker));
+
+	for (i=0;i<num_threads;i++) {
+		SimWorker *worker = &workers[i];
+		worker->id = i;
+		worker->num_players = num_players;
+		worker->num_decks = num_decks;
+		worker->penetration = penetration;
+		worker->strategy = strategy;
+		worker->rounds = rounds/num_threads + (i<rounds%num_threads ? 1 : 0);
+		assert(rng_stream(&worker->rng,rng,i));
+		assert(pthread_create(&worker->thread,NULL,sim_worker_main,worker)==0);
+	}
+
+	// Merge once everyone is done
+	for (i=0;i<num_threads;i++) {
+		assert(pthread_join(workers[i].thread,NULL)==0);
+		sim_stats_merge(stats,&workers[i].stats);
+	}
+	free(workers);
+	return TRUE;
+}
+
+/**
+ * Entry point for --simulate, plays the rounds and reports how fast
+ * they were played. If num_threads is 0 all cores are used.
+ */
+int sim_main(int num_players,long rounds,const char *name,int num_decks,double penetration,const Rng *rng,int num_threads) {
+	SimStats stats;
+	struct timespec start,end;
+
+	Strategy *strategy = strategy_find(name);
+	if (strategy==NULL) {
+		printf("Error: Unknown strategy '%s'\n",name);
+		return EXIT_FAILURE;
+	}
+	if (num_threads<1) {
+		num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (num_threads>rounds) {
+		num_threads = (int)rounds;
+	}
+
+	memset(&stats,0,sizeof(SimStats));
+	strategy_init(rng);
+	printf("Simulating %li rounds with %i players and %i decks using the '%s' strategy on %i threads...\n",rounds,num_players,num_decks,strategy->name,num_threads);
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	assert(sim_run_parallel(num_players,rounds,strategy,num_decks,penetration,rng,num_threads,&stats));
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	double elapsed = (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+
+	printf("-----------------------------------\n");
+	printf("Rounds:     %li\n",stats.rounds);
+	printf("Hands:      %li\n",stats.hands);
+	printf("Wins:       %li (%0.2f%%)\n",stats.wins,100.0*stats.wins/stats.hands);
+	printf("Pushes:     %li (%0.2f%%)\n",stats.pushes,100.0*stats.pushes/stats.hands);
+	printf("Losses:     %li (%0.2f%%)\n",stats.losses,100.0*stats.losses/stats.hands);
+	printf("Blackjacks: %li (%0.2f%%)\n",stats.blackjacks,100.0*stats.blackjacks/stats.hands);
+	printf("Busts:      %li (%0.2f%%)\n",stats.busts,100.0*stats.busts/stats.hands);
+	printf("Wagered:    $" MONEY_FMT "\n",MONEY_ARGS(stats.wagered));
+	printf("Net:        $" MONEY_FMT " (%0.3f%% of wagered)\n",MONEY_ARGS(stats.net),100.0*stats.net/stats.wagered);
+	printf("Time:       %0.3fs\n",elapsed);
+	printf("Hands/sec:  %0.0f\n",stats.hands/elapsed);
+	return EXIT_SUCCESS;
+}
+
+// ========================================= SIMULATOR =================================================
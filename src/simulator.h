@@ -0,0 +1,61 @@
+/*
+ * simulator.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Headless simulator that plays rounds in-process. Seats are driven by
+ *  strategy callbacks instead of player processes so no fork/pipe round
+ *  trips are needed.
+ */
+#include "blackjack.h"
+
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#ifndef Strategy
+/**
+ * Decides what a simulated seat does. The whole table is passed along
+ * with the dealer at seat 0 since all players can see their hand.
+ * Player processes use answer instead of bet and hit if it's set, it gets
+ * the dealer's message and fills in the reply. returns FALSE if it's
+ * not something that gets answered. attach is called (if set) when a
+ * player process sits down at a table.
+ */
+typedef struct Strategy {
+	char *name;
+	Money (*bet)(struct Strategy *strategy,Seats *seats,int seat);
+	bool (*hit)(struct Strategy *strategy,Seats *seats,int seat);
+	void *data;
+	bool (*answer)(struct Strategy *strategy,Client *client,const Message *msg,Message *reply);
+	void (*attach)(struct Strategy *strategy,Client *client);
+} Strategy;
+Strategy *strategy_find(const char *name);
+void strategy_init(const Rng *rng);
+void strategy_seed(int stream);
+void strategy_attach(Strategy *strategy,Client *client);
+#endif
+
+#ifndef SimStats
+/**
+ * Results of simulated rounds
+ */
+typedef struct SimStats {
+	long rounds;
+	long hands; // Player hands settled
+	long wins;
+	long pushes;
+	long losses;
+	long blackjacks; // 21 on the first two cards
+	long busts;
+	Money wagered;
+	Money net; // Won (or lost) by the players
+} SimStats;
+#endif
+
+bool sim_run(Blackjack *game,Strategy *strategies[],long rounds,SimStats *stats);
+bool sim_run_parallel(int num_players,long rounds,Strategy *strategy,int num_decks,double penetration,const Rng *rng,int num_threads,SimStats *stats);
+void sim_stats_merge(SimStats *total,const SimStats *part);
+int sim_main(int num_players,long rounds,const char *strategy,int num_decks,double penetration,const Rng *rng,int num_threads);
+
+#endif /* SIMULATOR_H_ */
@@ -0,0 +1,930 @@
+/*
+ * table.c
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  The dealer side of the game. Instead of blocking on one player at a time
+ *  each table asks its players and goes on to the next step once they have
+ *  all answered or run out of time:
+ *
+ *      JOINING -> BETTING -> PLAYING (one turn per seat) -> BETTING ...
+ *
+ *  A table closes once all its players are gone.
+ */
+#include <errno.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include "restart.h"
+#include "blackjack.h"
+#include "table.h"
+
+// ========================================= TABLE =================================================
+
+/**
+ * Prints the play by play if the table is verbose
+ */
+static void table_printf(Table *table,const char *fmt,...) {
+	if (!table->verbose) {
+		return;
+	}
+	va_list args;
+	va_start(args,fmt);
+	vprintf(fmt,args);
+	va_end(args);
+}
+
+static void table_start_round(Table *table);
+static void table_next_turn(Table *table);
+
+/**
+ * Adds a record for the player in seat to the history, if it's kept
+ */
+static void table_record(Table *table,HistoryType type,int seat,int value,int64_t amount) {
+	History *history = table->manager->history;
+	if (history!=NULL) {
+		history_add(history,type,table->id,table->game->seats.id[seat],value,amount);
+	}
+}
+
+/**
+ * Records the cards dealt to the seat starting at the first one, along
+ * with a shuffle if the shoe was shuffled to deal them.
+ */
+static void table_record_cards(Table *table,int seat,int first) {
+	Blackjack *game = table->game;
+	Seats *seats = &game->seats;
+	int i;
+	if (table->manager->history==NULL) {
+		return;
+	}
+	if (table->shuffles!=game->shoe->shuffles) {
+		table->shuffles = game->shoe->shuffles;
+		table_record(table,HIST_SHUFFLE,0,game->rng.type,(int64_t)game->rng.seed);
+	}
+	for (i=first;i<seats->_num_cards[seat];i++) {
+		table_record(table,HIST_CARD,seat,seats->cards[seat][i],0);
+	}
+}
+
+/**
+ * Gets rid of the player, their process goes back to the pool
+ */
+static void table_remove_player(Table *table,int seat) {
+	TableManager *manager = table->manager;
+	Seats *seats = &table->game->seats;
+	Client *client = table->clients[seats->id[seat]];
+	MetricsPage *page = manager->metrics->page;
+	table_record(table,HIST_LEAVE,seat,0,seats->money[seat]);
+	metrics_add(&page->leaves,1);
+	metrics_add(&page->players,-1);
+	metrics_add(&page->bankroll,-seats->money[seat]);
+	if (client!=NULL) {
+		client_unwatch(manager->epfd,client);
+		if (!client_pool_detach(manager->pool,client)) {
+			manager->_dead[manager->_num_dead++] = client;
+		}
+		table->clients[seats->id[seat]] = NULL;
+	}
+	table->waiting &= ~(1<<seats->id[seat]);
+	assert(blackjack_remove_player(table->game,seat));
+}
+
+/**
+ * Their process went away, they're removed at the next safe point.
+ */
+static void table_lost_client(Table *table,Client *client) {
+	client_unwatch(table->manager->epfd,client);
+	table->manager->_dead[table->manager->_num_dead++] = client;
+	table->clients[client->id] = NULL;
+}
+
+// ========================================= DEADLINES =================================================
+
+static void table_deadlines_swap(TableManager *manager,int i,int j) {
+	Table *t = manager->_deadlines[i];
+	manager->_deadlines[i] = manager->_deadlines[j];
+	manager->_deadlines[j] = t;
+	manager->_deadlines[i]->_deadline_index = i;
+	manager->_deadlines[j]->_deadline_index = j;
+}
+
+static void table_deadlines_up(TableManager *manager,int i) {
+	while (i>0 && timercmp(&manager->_deadlines[i]->deadline,&manager->_deadlines[(i-1)/2]->deadline,<)) {
+		table_deadlines_swap(manager,i,(i-1)/2);
+		i = (i-1)/2;
+	}
+}
+
+static void table_deadlines_down(TableManager *manager,int i) {
+	int n = manager->_num_deadlines;
+	while (TRUE) {
+		int least = i;
+		int l = 2*i+1;
+		int r = 2*i+2;
+		if (l<n && timercmp(&manager->_deadlines[l]->deadline,&manager->_deadlines[least]->deadline,<)) {
+			least = l;
+		}
+		if (r<n && timercmp(&manager->_deadlines[r]->deadline,&manager->_deadlines[least]->deadline,<)) {
+			least = r;
+		}
+		if (least==i) {
+			return;
+		}
+		table_deadlines_swap(manager,i,least);
+		i = least;
+	}
+}
+
+/**
+ * Puts the table in its place in the deadline heap after its deadline
+ * changed, or takes it out if it no longer has one.
+ */
+static void table_deadline_moved(Table *table) {
+	TableManager *manager = table->manager;
+	int i = table->_deadline_index;
+	if (!timerisset(&table->deadline)) {
+		if (i>=0) {
+			table->_deadline_index = -1;
+			manager->_num_deadlines--;
+			if (i<manager->_num_deadlines) {
+				manager->_deadlines[i] = manager->_deadlines[manager->_num_deadlines];
+				manager->_deadlines[i]->_deadline_index = i;
+				table_deadlines_up(manager,i);
+				table_deadlines_down(manager,manager->_deadlines[i]->_deadline_index);
+			}
+		}
+		return;
+	}
+	if (i<0) {
+		i = manager->_num_deadlines++;
+		manager->_deadlines[i] = table;
+		table->_deadline_index = i;
+	}
+	table_deadlines_up(manager,i);
+	table_deadlines_down(manager,table->_deadline_index);
+}
+
+/**
+ * Starts the clock on whatever the table is waiting for
+ */
+static void table_set_deadline(Table *table) {
+	if (table->manager->timeout>0) {
+		table->deadline = r_add2currenttime(table->manager->timeout);
+	} else {
+		timerclear(&table->deadline);
+	}
+	table_deadline_moved(table);
+}
+
+static void table_clear_deadline(Table *table) {
+	timerclear(&table->deadline);
+	table_deadline_moved(table);
+}
+
+/**
+ * Marks the table done, the manager removes it before it waits again
+ */
+static void table_close(Table *table) {
+	table->state = TABLE_CLOSED;
+	table_clear_deadline(table);
+	table->manager->_num_closed++;
+}
+
+// ========================================= DEADLINES =================================================
+
+/**
+ * Has the manager poll the table's rings before it next sleeps
+ */
+static void table_poll_later(Table *table) {
+	TableManager *manager = table->manager;
+	if (!table->_polled) {
+		table->_polled = TRUE;
+		manager->_polled[manager->_num_polled++] = table;
+	}
+}
+
+/**
+ * Sends the request, timing how long the write takes
+ */
+static bool table_ask(Table *table,Client *client,Message *msg) {
+	uint64_t start = latency_now();
+	bool ok = client_ask(client,msg);
+	if (client->ring!=NULL) {
+		table_poll_later(table);
+	}
+	latency_since(table->manager->latency,LAT_SEND,start);
+	metrics_add(&table->manager->metrics->page->sent[client->id],1);
+	return ok;
+}
+
+/**
+ * Asks every player the same thing at once. Anyone whose
+ * process is gone is removed.
+ */
+static void table_ask_all(Table *table,MessageOp op) {
+	Blackjack *game = table->game;
+	Seats *seats = &game->seats;
+	Client *client;
+	Message msg;
+	int seat;
+	table->waiting = 0;
+	for (seat=1;seat<game->_num_players;seat++) {
+		client = table->clients[seats->id[seat]];
+		message_init(&msg,op,seats->id[seat]);
+		if (client!=NULL && table_ask(table,client,&msg)) {
+			table->waiting |= 1<<seats->id[seat];
+		} else {
+			table_printf(table,"Player %i left the table with $" MONEY_FMT ".\n",seats->id[seat],MONEY_ARGS(seats->money[seat]));
+			table_remove_player(table,seat);
+			seat--;
+		}
+	}
+	table_set_deadline(table);
+}
+
+/**
+ * Prints the exact EV of standing and hitting from the cards left in the shoe
+ */
+static void table_advise(Table *table,int seat) {
+	Seats *seats = &table->game->seats;
+	double stand,hit;
+	bool should_hit;
+	// Only what's left in this shoe matters, old entries would just fill the memo
+	analyzer_clear(table->analyzer);
+	should_hit = analyzer_advise(table->analyzer,table->game->shoe,seats,seat,&stand,&hit);
+	table_printf(table,"Player %i expects %+0.3f standing and %+0.3f hitting, %s.\n",seats->id[seat],stand,hit,should_hit ? "hit" : "stand");
+}
+
+/**
+ * Asks whoever's turn it is if they want to hit. returns FALSE if they
+ * can't be asked or already have 21, they stay.
+ */
+static bool table_ask_hit(Table *table) {
+	Seats *seats = &table->game->seats;
+	int seat = table->turn;
+	Client *client = table->clients[seats->id[seat]];
+	Message msg;
+	if (client==NULL || !player_can_hit(seats,seat)) {
+		return FALSE;
+	}
+	if (table->analyzer!=NULL) {
+		table_advise(table,seat);
+	}
+	message_init(&msg,MSG_HIT,seats->id[seat]);
+	message_set_cards(&msg,seats,seat);
+	if (!table_ask(table,client,&msg)) {
+		return FALSE;
+	}
+	table->asked = latency_now();
+	table->waiting = 1<<seats->id[seat];
+	table_set_deadline(table);
+	return TRUE;
+}
+
+/**
+ * The dealer plays, everyone gets paid and then the next round starts
+ */
+static void table_finish_round(Table *table) {
+	Blackjack *game = table->game;
+	Seats *seats = &game->seats;
+	Latency *latency = table->manager->latency;
+	MetricsPage *page = table->manager->metrics->page;
+	char cards[SEATS_CARDS_STR_MAX];
+	int seat;
+
+	// DONE: Dealer choose to hit or stay
+	// Dealer:
+	//  - Always stays on 17 or higher
+	//  - Always hits on 16 or lower
+	uint64_t start = latency_now();
+	table_printf(table,"\nDealers turn:\n");
+	table_printf(table,"-----------------------------------\n");
+	if (table->verbose) {
+		player_cards_format(seats,0,cards,sizeof(cards));
+		table_printf(table,"Dealer has cards %s\n",cards);
+	}
+	while (!(seats->busted[0]) && (seats->score[0]<DEALER_STANDS)) {
+		assert(blackjack_deal_card(game,0));
+		table_record_cards(table,0,seats->_num_cards[0]-1);
+		if (table->verbose) {
+			card_format(seats->cards[0][seats->_num_cards[0]-1],cards,sizeof(cards));
+			table_printf(table,"Dealer hit and got [%s] giving score of %i\n",cards,seats->score[0]);
+		}
+	}
+	if (seats->busted[0]) {
+		table_printf(table,"Dealer busted\n");
+	} else {
+		table_printf(table,"Dealer stayed with score %i\n",seats->score[0]);
+	}
+
+	start = latency_since(latency,LAT_DEALER,start);
+
+	// DONE: Round is over print out the hands
+	// Determine who won/lost and send that to the clients
+	table_printf(table,"\n\nRound results:\n");
+	table_printf(table,"-----------------------------------\n");
+	for (seat=1;seat<(game->_num_players);seat++) {
+		if (seats->bet[seat]==0) { // sat out
+			continue;
+		}
+		Money money = seats->money[seat];
+		Money won = player_settle(seats,seat,0);
+		table_record(table,HIST_PAYOUT,seat,0,won);
+		metrics_add(&page->hands,1);
+		metrics_add(won>0 ? &page->wins : won==0 ? &page->pushes : &page->losses,1);
+		metrics_add(&page->bankroll,seats->money[seat]-money);
+		if (seats->busted[seat]) {
+			metrics_add(&page->busts,1);
+		} else if (seats->blackjack[seat]) {
+			metrics_add(&page->blackjacks,1);
+		}
+		if (won>0) {
+			table_printf(table,"Player %i won $" MONEY_FMT " and has $" MONEY_FMT "!\n",seats->id[seat],MONEY_ARGS(won),MONEY_ARGS(seats->money[seat]));
+		} else if(won==0) {
+			table_printf(table,"Player %i tied dealer and has $" MONEY_FMT "!\n",seats->id[seat],MONEY_ARGS(seats->money[seat]));
+		} else {
+			table_printf(table,"Player %i lost $" MONEY_FMT " and has $" MONEY_FMT "!\n",seats->id[seat],MONEY_ARGS(seats->bet[seat]),MONEY_ARGS(seats->money[seat]));
+		}
+	}
+
+	// Remove anyone that's broke or gone
+	for (seat=1;seat<(game->_num_players);seat++) {
+		if (seats->money[seat]<MONEY_MIN_BET || table->clients[seats->id[seat]]==NULL) {
+			table_printf(table,"Player %i left the table.\n",seats->id[seat]);
+			table_remove_player(table,seat);
+			seat--;
+		}
+	}
+	latency_since(latency,LAT_SETTLE,start);
+	latency_since(latency,LAT_ROUND,table->round_start);
+	metrics_add(&page->rounds,1);
+	table->rounds++;
+	table_start_round(table);
+}
+
+/**
+ * Moves on to the next player that has a bet in, once
+ * everyone has played the dealer goes.
+ */
+static void table_next_turn(Table *table) {
+	Blackjack *game = table->game;
+	Seats *seats = &game->seats;
+	char cards[SEATS_CARDS_STR_MAX];
+	int seat;
+
+	if (table->turn>0) { // Their turn is over
+		latency_since(table->manager->latency,LAT_TURN,table->phase_start);
+	}
+	for (table->turn++;table->turn<game->_num_players;table->turn++) {
+		seat = table->turn;
+		if (seats->bet[seat]==0) { // sitting out
+			continue;
+		}
+		table->phase_start = latency_now();
+		table_printf(table,"\nPlayer %i's turn:\n",seats->id[seat]);
+		table_printf(table,"-----------------------------------\n");
+		if (table->verbose) {
+			player_cards_format(seats,seat,cards,sizeof(cards));
+			table_printf(table,"Player %i has cards %s.\n",seats->id[seat],cards);
+		}
+		if (table_ask_hit(table)) {
+			return;
+		}
+		latency_since(table->manager->latency,LAT_TURN,table->phase_start);
+		table_printf(table,"Player %i stayed with score %i.\n",seats->id[seat],seats->score[seat]);
+	}
+	table->waiting = 0;
+	table_finish_round(table);
+}
+
+/**
+ * Bets are in (or out of time), start the turns
+ */
+static void table_play(Table *table) {
+	table->waiting = 0;
+	latency_since(table->manager->latency,LAT_BETS,table->phase_start);
+
+	// Nobody is playing
+	if (table->game->_num_players<2) {
+		table_close(table);
+		return;
+	}
+	table->state = TABLE_PLAYING;
+	table->turn = 0; // Dealer, next is the first player
+	table_next_turn(table);
+}
+
+/**
+ * Starts a new round by dealing and asking for bets
+ */
+static void table_start_round(Table *table) {
+	int seat;
+	if (table->game->_num_players<2) {
+		table_close(table);
+		return;
+	}
+	table->round_start = latency_now();
+	table_printf(table,"\nStarting new round:\n");
+	table_printf(table,"-----------------------------------\n");
+
+	// Start the game
+	assert(blackjack_init_round(table->game));
+	table_record(table,HIST_ROUND,0,0,table->rounds);
+	for (seat=0;seat<table->game->_num_players;seat++) {
+		table_record_cards(table,seat,0);
+	}
+
+	table_printf(table,"\nBets in:\n");
+	table_printf(table,"-----------------------------------\n");
+	table->state = TABLE_BETTING;
+	table->phase_start = latency_now();
+	table_ask_all(table,MSG_BET);
+	if (table->waiting==0) {
+		table_play(table);
+	}
+}
+
+/**
+ * Handles a reply to the last thing the player was asked
+ */
+static void table_on_reply(Table *table,int seat,Message *reply) {
+	Seats *seats = &table->game->seats;
+	table->waiting &= ~(1<<seats->id[seat]);
+	switch (table->state) {
+		case TABLE_JOINING:
+			if (reply->op==MSG_REPLY && (reply->amount<=0 || reply->amount>MONEY_MAX)) {
+				table_printf(table,"Player %i can't sit down with that amount.\n",seats->id[seat]);
+				table_remove_player(table,seat);
+			} else if (reply->op==MSG_REPLY) {
+				seats->money[seat] = reply->amount;
+				table_record(table,HIST_JOIN,seat,0,seats->money[seat]);
+				metrics_add(&table->manager->metrics->page->bankroll,seats->money[seat]);
+				table_printf(table,"Player %i playing with $" MONEY_FMT "\n",seats->id[seat],MONEY_ARGS(seats->money[seat]));
+			} else {
+				table_printf(table,"Player %i never sat down.\n",seats->id[seat]);
+				table_remove_player(table,seat);
+			}
+			if (table->waiting==0) {
+				table_start_round(table);
+			}
+			break;
+		case TABLE_BETTING:
+			if (reply->op==MSG_REPLY && reply->amount>0 && player_bet(seats,seat,reply->amount)) {
+				table_record(table,HIST_BET,seat,0,seats->bet[seat]);
+				metrics_add(&table->manager->metrics->page->wagered,seats->bet[seat]);
+				metrics_add(&table->manager->metrics->page->bankroll,-seats->bet[seat]);
+				table_printf(table,"Player %i bet $" MONEY_FMT ".\n",seats->id[seat],MONEY_ARGS(seats->bet[seat]));
+			} else {
+				table_printf(table,"Player %i left the table with $" MONEY_FMT ".\n",seats->id[seat],MONEY_ARGS(seats->money[seat]));
+				table_remove_player(table,seat);
+			}
+			if (table->waiting==0) {
+				table_play(table);
+			}
+			break;
+		case TABLE_PLAYING:
+			if (reply->op==MSG_REPLY) {
+				latency_since(table->manager->latency,LAT_DECISION,table->asked);
+			}
+			table_record(table,HIST_DECISION,seat,reply->op==MSG_REPLY && reply->decision,0);
+			if (reply->op==MSG_REPLY && reply->decision) {
+				assert(blackjack_deal_card(table->game,seat));
+				table_record_cards(table,seat,seats->_num_cards[seat]-1);
+				if (table->verbose) {
+					char card[CARD_STR_MAX];
+					card_format(seats->cards[seat][seats->_num_cards[seat]-1],card,sizeof(card));
+					table_printf(table,"Player %i hit and got [%s] giving score of %i.\n",seats->id[seat],card,seats->score[seat]);
+				}
+				if (!seats->busted[seat] && table_ask_hit(table)) {
+					break;
+				}
+			}
+			if (seats->busted[seat]) {
+				table_printf(table,"Player %i busted.\n",seats->id[seat]);
+			} else {
+				table_printf(table,"Player %i stayed with score %i.\n",seats->id[seat],seats->score[seat]);
+			}
+			table_next_turn(table);
+			break;
+		case TABLE_CLOSED:
+			break;
+	}
+}
+
+/**
+ * Whoever hasn't answered by the deadline is out of time
+ */
+static void table_on_timeout(Table *table) {
+	Blackjack *game = table->game;
+	Seats *seats = &game->seats;
+	Message reply;
+	int seat;
+	table_clear_deadline(table);
+	switch (table->state) {
+		case TABLE_JOINING:
+			for (seat=1;seat<game->_num_players;seat++) {
+				if (table->waiting & (1<<seats->id[seat])) {
+					table_printf(table,"Player %i never sat down.\n",seats->id[seat]);
+					table_remove_player(table,seat);
+					seat--;
+				}
+			}
+			table_start_round(table);
+			break;
+		case TABLE_PLAYING:
+			// Only the player whose turn it is gets asked, they stay
+			if (table->waiting==0) {
+				break;
+			}
+			seat = table->turn;
+			table_printf(table,"Player %i took too long.\n",seats->id[seat]);
+			message_init(&reply,0,seats->id[seat]);
+			table_on_reply(table,seat,&reply);
+			break;
+		case TABLE_BETTING:
+			// Too slow, bet stays 0
+			for (seat=1;seat<game->_num_players;seat++) {
+				if (table->waiting & (1<<seats->id[seat])) {
+					table_printf(table,"Player %i sat out this round.\n",seats->id[seat]);
+				}
+			}
+			table_play(table);
+			break;
+		case TABLE_CLOSED:
+			break;
+	}
+}
+
+/**
+ * Passes on a message from the client if it's the reply being waited on
+ */
+static void table_on_message(Table *table,Client *client,Message *msg) {
+	int seat = blackjack_find_player(table->game,client->id);
+	metrics_add(&table->manager->metrics->page->received[client->id],1);
+	if (seat==-1 || !(table->waiting & (1<<client->id)) || msg->seq!=client->seq) {
+		return; // not waiting on this one, it's late
+	}
+	table_on_reply(table,seat,msg);
+}
+
+/**
+ * Reads what the client sent and hands it to the table, over shm
+ * it only rang and the table's rings are polled later
+ */
+static void table_on_readable(Table *table,Client *client) {
+	int seat = blackjack_find_player(table->game,client->id);
+	Message msg;
+	uint64_t start = latency_now();
+	bool ok;
+	if (client->ring!=NULL) { // Rang, the reply is in the ring
+		ok = client_bell(client);
+		if (ok) {
+			table_poll_later(table);
+			return;
+		}
+	} else {
+		ok = client_recv(client,&msg);
+		latency_since(table->manager->latency,LAT_RECV,start);
+	}
+	if (!ok) { // they're gone
+		table_lost_client(table,client);
+		if (seat!=-1 && (table->waiting & (1<<client->id))) {
+			message_init(&msg,MSG_EXIT,client->id);
+			table_on_reply(table,seat,&msg);
+		}
+		return;
+	}
+	table_on_message(table,client,&msg);
+}
+
+/**
+ * Handles whatever replies are in the table's rings, then parks the rings
+ * unless it has asked for more in the meantime
+ */
+static void table_poll(Table *table) {
+	Message msg;
+	Client *client;
+	uint64_t start;
+	int id;
+	table->_polled = FALSE;
+	for (id=0;id<7;id++) {
+		client = table->clients[id];
+		if (client==NULL || client->ring==NULL) {
+			continue;
+		}
+		start = latency_now();
+		while (table->clients[id]==client && client_poll(client,&msg)) {
+			latency_since(table->manager->latency,LAT_RECV,start);
+			table_on_message(table,client,&msg);
+			start = latency_now();
+		}
+	}
+	if (table->_polled) {
+		return; // Asked again, it's polled next time round
+	}
+	for (id=0;id<7;id++) {
+		client = table->clients[id];
+		if (client!=NULL && client->ring!=NULL && !client_park(client)) {
+			table_poll_later(table);
+		}
+	}
+}
+
+// ========================================= TABLE =================================================
+
+// ========================================= TABLE MANAGER =================================================
+
+TableManager *table_manager_create(double timeout,ClientPool *pool,int num_decks,double penetration,const Rng *rng) {
+	TableManager *manager = malloc(sizeof(TableManager));
+	assert(manager != NULL);
+	manager->epfd = epoll_create1(0);
+	assert(manager->epfd != -1);
+	manager->_size = 16;
+	manager->tables = malloc(manager->_size*sizeof(Table *));
+	assert(manager->tables != NULL);
+	manager->_num_tables = 0;
+	manager->_next_id = 0;
+	manager->_dead = malloc(manager->_size*7*sizeof(Client *));
+	assert(manager->_dead != NULL);
+	manager->_num_dead = 0;
+	manager->_deadlines = malloc(manager->_size*sizeof(Table *));
+	assert(manager->_deadlines != NULL);
+	manager->_num_deadlines = 0;
+	manager->_num_closed = 0;
+	manager->_polled = malloc(2*manager->_size*sizeof(Table *));
+	assert(manager->_polled != NULL);
+	manager->_num_polled = 0;
+	manager->timeout = timeout;
+	manager->pool = pool;
+	manager->num_decks = num_decks;
+	manager->penetration = penetration;
+	manager->rng = *rng;
+	assert(rng_stream(&manager->_next_rng,rng,0));
+	manager->rounds = 0;
+	manager->history = NULL;
+	manager->latency = latency_create();
+	manager->metrics = metrics_create(NULL,manager->latency);
+	assert(manager->metrics!=NULL);
+	manager->advise = FALSE;
+	return manager;
+}
+
+/**
+ * Frees clients that were removed while events were being handled
+ */
+static void table_manager_bury(TableManager *manager) {
+	while (manager->_num_dead>0) {
+		manager->_num_dead--;
+		assert(client_destroy(manager->_dead[manager->_num_dead]));
+	}
+	r_wait_all();
+}
+
+bool table_manager_destroy(TableManager *manager) {
+	assert(manager!=NULL);
+	while (manager->_num_tables>0) {
+		assert(table_manager_remove(manager,manager->tables[0]));
+	}
+	assert(client_pool_destroy(manager->pool));
+	table_manager_bury(manager);
+	assert(r_close(manager->epfd)!=-1);
+	assert(metrics_destroy(manager->metrics));
+	assert(latency_destroy(manager->latency));
+	if (manager->history!=NULL && !history_destroy(manager->history)) {
+		perror("Failed to write the hand history");
+	}
+	free(manager->_dead);
+	free(manager->_deadlines);
+	free(manager->_polled);
+	free(manager->tables);
+	free(manager);
+	return TRUE;
+}
+
+/**
+ * Opens a new table, each player is given a process from the pool,
+ * and asks them how much they're playing with.
+ */
+Table *table_manager_add(TableManager *manager,int num_players,bool verbose) {
+	Table *table = malloc(sizeof(Table));
+	Rng rng;
+	int i;
+	assert(table != NULL);
+	assert(num_players>=1 && num_players<=6);
+
+	// Make room
+	if (manager->_num_tables==manager->_size) {
+		manager->_size *= 2;
+		manager->tables = realloc(manager->tables,manager->_size*sizeof(Table *));
+		assert(manager->tables != NULL);
+		manager->_dead = realloc(manager->_dead,manager->_size*7*sizeof(Client *));
+		assert(manager->_dead != NULL);
+		manager->_deadlines = realloc(manager->_deadlines,manager->_size*sizeof(Table *));
+		assert(manager->_deadlines != NULL);
+		manager->_polled = realloc(manager->_polled,2*manager->_size*sizeof(Table *));
+		assert(manager->_polled != NULL);
+	}
+
+	table->id = manager->_next_id++;
+	table->manager = manager;
+	table->verbose = verbose;
+	table->analyzer = (manager->advise && verbose) ? analyzer_create(manager->num_decks) : NULL;
+	table->rounds = 0;
+	table->shuffles = 0;
+	table->turn = 0;
+	table->waiting = 0;
+	timerclear(&table->deadline);
+	table->_deadline_index = -1;
+	table->_polled = FALSE;
+	rng = manager->_next_rng; // Same as stream table->id, without jumping there from the start
+	assert(rng_stream_next(&manager->_next_rng));
+	table->game = blackjack_create(num_players+1,manager->num_decks,manager->penetration,&rng); // +1 for dealer
+	memset(table->clients,0,sizeof(table->clients)); // [0] is the dealer, past num_players nobody
+	for (i=1;i<num_players+1;i++) { // so index is same as player id
+		table->clients[i] = client_pool_attach(manager->pool,table->id,i);
+		if (table->clients[i]!=NULL) { // else they're removed when asked to sit
+			table->clients[i]->owner = table;
+			assert(client_watch(manager->epfd,table->clients[i]));
+		}
+	}
+	table->_index = manager->_num_tables;
+	manager->tables[manager->_num_tables++] = table;
+	metrics_add(&manager->metrics->page->joins,num_players);
+	metrics_add(&manager->metrics->page->players,num_players);
+
+	// When a player enters the game, they will tell the dealer the
+	// amount of money they will use to begin the game.
+	table->state = TABLE_JOINING;
+	table_ask_all(table,MSG_AMT);
+	if (table->waiting==0) {
+		table_start_round(table);
+	}
+	return table;
+}
+
+/**
+ * Closes the table, anyone still at it is told to leave
+ */
+bool table_manager_remove(TableManager *manager,Table *table) {
+	int i = table->_index;
+	if (i<0 || i>=manager->_num_tables || manager->tables[i]!=table) {
+		return FALSE;
+	}
+	manager->tables[i] = manager->tables[--manager->_num_tables];
+	manager->tables[i]->_index = i;
+	table_clear_deadline(table);
+	if (table->state==TABLE_CLOSED) {
+		manager->_num_closed--;
+	}
+	if (table->_polled) {
+		for (i=0;manager->_polled[i]!=table;i++);
+		manager->_polled[i] = manager->_polled[--manager->_num_polled];
+	}
+
+	while (table->game->_num_players>1) {
+		table_remove_player(table,1);
+	}
+	manager->rounds += table->rounds;
+	assert(blackjack_destroy(table->game));
+	if (table->analyzer!=NULL) {
+		assert(analyzer_destroy(table->analyzer));
+	}
+	free(table);
+	table_manager_bury(manager);
+	return TRUE;
+}
+
+/**
+ * Players at all the tables
+ */
+int table_manager_num_players(TableManager *manager) {
+	int i;
+	int total = 0;
+	for (i=0;i<manager->_num_tables;i++) {
+		total += manager->tables[i]->game->_num_players-1;
+	}
+	return total;
+}
+
+/**
+ * Shares the counters in path.page and serves them on a Unix socket at
+ * path. returns FALSE if they can't be, the counters are kept either way.
+ */
+bool table_manager_export(TableManager *manager,const char *path) {
+	Metrics *metrics = metrics_create(path,manager->latency);
+	if (metrics==NULL) {
+		return FALSE;
+	}
+	memcpy(metrics->page,manager->metrics->page,sizeof(MetricsPage)); // Keep counting from where it was
+	assert(metrics_destroy(manager->metrics));
+	manager->metrics = metrics;
+	return TRUE;
+}
+
+/**
+ * Handles the tables whose deadline passed and returns the
+ * milliseconds until the next one (-1 if none).
+ */
+static int table_manager_check_deadlines(TableManager *manager) {
+	struct timeval now;
+	int timeout = -1;
+	Table *table;
+	gettimeofday(&now,NULL);
+	while (manager->_num_deadlines>0) {
+		table = manager->_deadlines[0];
+		if (timercmp(&now,&table->deadline,<)) {
+			timeout = (table->deadline.tv_sec-now.tv_sec)*1000+(table->deadline.tv_usec-now.tv_usec)/1000+1;
+			break;
+		}
+		table_on_timeout(table); // Clears or pushes back its deadline
+	}
+	return timeout;
+}
+
+/**
+ * Polls the rings of the tables that asked for something since the last
+ * time, so replies that are already in don't need the player to ring
+ */
+static void table_manager_poll(TableManager *manager) {
+	int n = manager->_num_polled;
+	int i;
+	for (i=0;i<n;i++) {
+		Table *table = manager->_polled[i];
+		if (table->state!=TABLE_CLOSED) {
+			table_poll(table);
+		} else {
+			table->_polled = FALSE;
+		}
+	}
+	// Keep the ones listed again while polling
+	manager->_num_polled -= n;
+	memmove(manager->_polled,manager->_polled+n,manager->_num_polled*sizeof(Table *));
+}
+
+/**
+ * Runs every table until they have all closed
+ */
+bool table_manager_run(TableManager *manager) {
+	struct epoll_event events[CLIENT_MAX_EVENTS];
+	sigset_t usr1,mask,old;
+	int timeout;
+	int i,n;
+
+	// SIGUSR1 is only let in while waiting, so one sent while the
+	// events are handled still cuts the wait short
+	sigemptyset(&usr1);
+	sigaddset(&usr1,SIGUSR1);
+	assert(sigprocmask(SIG_BLOCK,&usr1,&old)==0);
+	mask = old;
+	sigdelset(&mask,SIGUSR1);
+
+	while (manager->_num_tables>0) {
+		// Close any tables that are done
+		for (i=0;manager->_num_closed>0 && i<manager->_num_tables;i++) {
+			if (manager->tables[i]->state==TABLE_CLOSED) {
+				assert(table_manager_remove(manager,manager->tables[i]));
+				i--;
+			}
+		}
+		if (manager->_num_tables==0) {
+			break;
+		}
+
+		table_manager_poll(manager);
+		timeout = table_manager_check_deadlines(manager);
+		if (manager->_num_polled>0 || manager->_num_closed>0) {
+			timeout = 0; // Replies to handle or tables to clear out already
+		}
+		n = epoll_pwait(manager->epfd,events,CLIENT_MAX_EVENTS,timeout,&mask);
+		if (latency_dump_requested) { // SIGUSR1
+			latency_dump_requested = 0;
+			latency_dump(manager->latency,stdout);
+		}
+		if (n==-1 && errno==EINTR) {
+			continue;
+		}
+		if (n==-1) {
+			assert(sigprocmask(SIG_SETMASK,&old,NULL)==0);
+			return FALSE;
+		}
+		for (i=0;i<n;i++) {
+			Client *client = events[i].data.ptr;
+			Table *table = client->owner;
+			if (table==NULL || table->clients[client->id]!=client) {
+				continue; // removed while handling an earlier event
+			}
+			table_on_readable(table,client);
+		}
+		table_manager_bury(manager);
+	}
+	assert(sigprocmask(SIG_SETMASK,&old,NULL)==0);
+	return TRUE;
+}
+
+// ========================================= TABLE MANAGER =================================================
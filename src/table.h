@@ -0,0 +1,92 @@
+/*
+ * table.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: jrm
+ *
+ *  Hosts any number of blackjack tables in the dealer process. Each table
+ *  is a small state machine that is moved along by its players' replies,
+ *  all tables share one epoll loop.
+ */
+#include <sys/time.h>
+#include "blackjack.h"
+#include "history.h"
+#include "latency.h"
+#include "metrics.h"
+#include "analyzer.h"
+
+#ifndef TABLE_H_
+#define TABLE_H_
+
+#ifndef TableState
+typedef enum { TABLE_JOINING,TABLE_BETTING,TABLE_PLAYING,TABLE_CLOSED } TableState;
+#endif
+
+struct TableManager;
+
+#ifndef Table
+/**
+ * One game and the player processes sitting at it
+ */
+typedef struct Table {
+	int id;
+	TableState state;
+	Blackjack *game;
+	Client *clients[7]; // By player id, NULL once their process is gone
+	unsigned char waiting; // Bit for each player id a reply is expected from
+	int turn; // Seat of whoever's turn it is
+	struct timeval deadline; // When the players being waited on run out of time
+	int _deadline_index; // Where it is in the manager's deadline heap, -1 if it has no deadline
+	int _index; // Where it is in the manager's tables
+	bool _polled; // In the manager's list of tables to poll the rings of
+	long rounds; // Rounds played
+	long shuffles; // Shuffles of the shoe already in the history
+	uint64_t round_start; // latency_now() when the round started
+	uint64_t phase_start; // When the bets or the current turn started
+	uint64_t asked; // When the player whose turn it is was asked
+	bool verbose; // Print the play by play
+	Analyzer *analyzer; // Works out the odds shown with each hit question, NULL for none
+	struct TableManager *manager;
+} Table;
+#endif
+
+#ifndef TableManager
+/**
+ * Owns the tables and the epoll loop that drives them
+ */
+typedef struct TableManager {
+	int epfd;
+	Table **tables;
+	int _num_tables;
+	int _size; // Room in tables
+	int _next_id;
+	Client **_dead; // Clients to free once the current events are handled
+	int _num_dead;
+	Table **_deadlines; // Min-heap of the tables with a deadline, soonest first
+	int _num_deadlines;
+	int _num_closed; // Tables closed since they were last cleared out
+	Table **_polled; // Tables expecting replies over shm, polled before sleeping. Room for each twice, they can be listed again while polled
+	int _num_polled;
+	double timeout; // Seconds a player has to answer, 0 is forever
+	ClientPool *pool; // Player processes not at a table, freed with the manager
+	int num_decks;
+	double penetration;
+	Rng rng; // Each table gets its own stream of this
+	Rng _next_rng; // Stream of rng for the next table, never drawn from
+	long rounds; // Rounds played by tables that have closed
+	History *history; // Where every hand is recorded, NULL for none. Closed with the manager
+	Latency *latency; // How long each phase of a round takes at all tables
+	Metrics *metrics; // Counters for all tables
+	bool advise; // Show the exact odds of hitting and standing at verbose tables
+} TableManager;
+#endif
+
+TableManager *table_manager_create(double timeout,ClientPool *pool,int num_decks,double penetration,const Rng *rng);
+bool table_manager_destroy(TableManager *manager);
+Table *table_manager_add(TableManager *manager,int num_players,bool verbose);
+bool table_manager_remove(TableManager *manager,Table *table);
+bool table_manager_run(TableManager *manager);
+int table_manager_num_players(TableManager *manager);
+bool table_manager_export(TableManager *manager,const char *path);
+
+#endif /* TABLE_H_ */